@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "simple_http.h"
+
+/**
+ * Differential fuzz target for parse_http_request.
+ * The first byte of the input seeds where the rest of the input is split into chunks, the chunked parse must end
+ * with exactly the same result(including how many bytes were parsed) as parsing the whole input in one call. The chunked request is also saved and restored
+ * with http_request_save/http_request_restore between chunks.
+ *
+ * Built with SIMPLE_HTTP_LIBFUZZER defined this is a libFuzzer target, otherwise main() runs every file given
+ * (or stdin for AFL) and reports execs/sec.
+ */
+
+//xorshift so the chunk boundaries are reproducible from the seed byte
+static uint32_t next_random(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static bool str_equal(const char *a, const char *b) {
+    if(!a || !b) {
+        return a == b;
+    }
+    return strcmp(a, b) == 0;
+}
+
+/**
+ * Aborts if the two requests did not parse to the same result
+ */
+static void require_equal(http_request_t *a, http_request_t *b) {
+    if(a -> state != b -> state || a -> error != b -> error) {
+        abort();
+    }
+
+    if(a -> method != b -> method || a -> version_major != b -> version_major || a -> version_minor != b -> version_minor) {
+        abort();
+    }
+
+    if(!str_equal(a -> path, b -> path)) {
+        abort();
+    }
+
+    if(a -> headers -> header_count != b -> headers -> header_count) {
+        abort();
+    }
+
+    for(uint64_t i = 0; i < a -> headers -> header_count; i++) {
+        if(!str_equal(a -> headers -> entries[i].key, b -> headers -> entries[i].key) ||
+           !str_equal(a -> headers -> entries[i].val, b -> headers -> entries[i].val)) {
+            abort();
+        }
+    }
+
+    if(a -> body_len != b -> body_len || (a -> body == 0) != (b -> body == 0)) {
+        abort();
+    }
+
+    if(a -> body && memcmp(a -> body, b -> body, a -> body_len) != 0) {
+        abort();
+    }
+}
+
+/**
+ * Moves req through a snapshot, aborts if the snapshot can't be restored
+ * @returns the restored request(req is freed)
+ */
+static http_request_t* save_and_restore(http_request_t *req) {
+    uint8_t snapshot[8192];
+    uint64_t size = http_request_save(req, snapshot, sizeof(snapshot));
+
+    if(size == 0 || size > sizeof(snapshot)) {
+        return req;
+    }
+
+    http_request_t *restored = http_request_restore(snapshot, size);
+    if(!restored) {
+        abort();
+    }
+
+    http_request_free(req);
+    return restored;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if(size == 0) {
+        return 0;
+    }
+
+    uint32_t seed = data[0] | 0x100;
+    const char *buf = (const char*) data + 1;
+    uint64_t buf_len = size - 1;
+
+    http_request_t *whole = http_request_init();
+    http_request_t *chunked = http_request_init();
+
+    if(!whole || !chunked) {
+        http_request_free(whole);
+        http_request_free(chunked);
+        return 0;
+    }
+
+    uint64_t whole_parsed = parse_http_request(whole, buf, buf_len);
+    uint64_t chunked_parsed = 0;
+
+    //Chunks are between 1 and 64 bytes long, including empty calls at the end
+    uint64_t i = 0;
+    while(i < buf_len) {
+        uint64_t chunk_len = next_random(&seed) % 64 + 1;
+        if(chunk_len > buf_len - i) {
+            chunk_len = buf_len - i;
+        }
+        chunked_parsed += parse_http_request(chunked, buf + i, chunk_len);
+        i += chunk_len;
+
+        if(next_random(&seed) % 4 == 0) {
+            chunked = save_and_restore(chunked);
+        }
+    }
+    parse_http_request(chunked, buf + buf_len, 0);
+
+    require_equal(whole, chunked);
+    //Where the next request or the tunnel starts
+    if(whole_parsed != chunked_parsed) {
+        abort();
+    }
+
+    http_request_free(whole);
+    http_request_free(chunked);
+    return 0;
+}
+
+#ifndef SIMPLE_HTTP_LIBFUZZER
+
+/**
+ * Reads a whole file into memory
+ * @returns the buffer or null if it could not be read
+ */
+static uint8_t* read_file(FILE *file, size_t *size) {
+    size_t cap = 4096;
+    uint8_t *buf = malloc(cap);
+    *size = 0;
+
+    while(buf) {
+        *size += fread(buf + *size, 1, cap - *size, file);
+        if(*size < cap) {
+            return buf;
+        }
+
+        cap *= 2;
+        uint8_t *temp = realloc(buf, cap);
+        if(!temp) {
+            free(buf);
+            return 0;
+        }
+        buf = temp;
+    }
+
+    return 0;
+}
+
+/**
+ * Usage: HTTP_FUZZ [-n iterations] [files...]
+ * Runs every file 'iterations' times(default 1) and prints execs/sec, reads stdin if no files are given
+ */
+int main(int argc, char **argv) {
+    uint64_t iterations = 1;
+    int first_file = 1;
+
+    if(argc > 2 && strcmp(argv[1], "-n") == 0) {
+        iterations = strtoull(argv[2], 0, 10);
+        first_file = 3;
+    }
+
+    int input_count = first_file < argc ? argc - first_file : 1;
+    uint8_t **inputs = calloc(input_count, sizeof(uint8_t*));
+    size_t *sizes = calloc(input_count, sizeof(size_t));
+
+    if(!inputs || !sizes) {
+        return 1;
+    }
+
+    for(int i = 0; i < input_count; i++) {
+        FILE *file = first_file < argc ? fopen(argv[first_file + i], "rb") : stdin;
+        if(!file) {
+            fprintf(stderr, "could not open %s\n", argv[first_file + i]);
+            return 1;
+        }
+
+        inputs[i] = read_file(file, &sizes[i]);
+        if(file != stdin) {
+            fclose(file);
+        }
+
+        if(!inputs[i]) {
+            return 1;
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(uint64_t n = 0; n < iterations; n++) {
+        for(int i = 0; i < input_count; i++) {
+            LLVMFuzzerTestOneInput(inputs[i], sizes[i]);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    uint64_t execs = iterations * input_count;
+    printf("execs: %llu, seconds: %.3f, execs/sec: %.0f\n", (unsigned long long) execs, seconds, seconds > 0 ? execs / seconds : 0);
+
+    for(int i = 0; i < input_count; i++) {
+        free(inputs[i]);
+    }
+    free(inputs);
+    free(sizes);
+
+    return 0;
+}
+
+#endif
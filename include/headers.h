@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "hashmap.h"
 #include "array.h"
+#include "simple_http_config.h"
 
 /**
  * headers is a hashmap of dynamically resizable arrays
@@ -22,8 +23,33 @@ typedef enum {
     HEADERS_OUT_OF_BOUNDS,
 } headers_state;
 
+/**
+ * A single header in the order it was added, key and val are owned by headers_t
+ */
+typedef struct {
+    char *key;
+    char *val;
+} header_entry_t;
+
+#ifdef HTTP_FIXED_BUFFERS
+/**
+ * Inline storage for one header so HTTP_FIXED_BUFFERS doesn't allocate per header
+ */
+typedef struct {
+    char key[HTTP_MAX_HEADER_KEY_SIZE + 1];
+    char val[HTTP_MAX_HEADER_VAL_SIZE + 1];
+} header_slot_t;
+#endif
+
 typedef struct _headers {
+#ifdef HTTP_FIXED_BUFFERS
+    //max_headers slots allocated with headers_t, entries[i] points into slots[i] and lookups scan entries
+    header_slot_t *slots;
+#else
     hashmap_t *headers;
+#endif
+    //Every header in the order it was added(header_count long), used for writing headers back out
+    header_entry_t *entries;
     uint64_t header_count;
     uint64_t max_headers;
 } headers_t;
@@ -40,18 +66,31 @@ headers_t* headers_init(uint64_t max_headers);
 void headers_free(headers_t *headers);
 
 /**
- * Can add header by supplying a key and val
+ * Maps every RFC 7230 token character(tchar) to its lowercase form.
+ * Any byte that is not allowed in a header key maps to 0.
+ */
+extern const unsigned char header_token_table[256];
+
+/**
+ * Can add header by supplying a key and val, headers_t owns both if succesful
+ * (if the key already exists 'key' is freed and the stored key is used instead)
  * @returns OUT_OF_BOUNDS if number of vals reached max headers or OUT_OF_MEM if failed malloc
  */
 headers_state add_header(headers_t *headers, char *key, char *val);
 /**
- * Gets the last value added to a specific key
+ * Adds a copy of a header, key and val don't need to be null terminated
+ * @returns OUT_OF_BOUNDS if number of vals reached max headers(or the key or val is longer than its max size with HTTP_FIXED_BUFFERS)
+ * or OUT_OF_MEM if failed malloc
+ */
+headers_state add_header_copy(headers_t *headers, const char *key, uint64_t key_len, const char *val, uint64_t val_len);
+/**
+ * Gets the last value added to a specific key(key is case insensitive)
  * @returns value or null if not found
  */
 char* get_last_header(headers_t *headers, char *key);
 
 /**
- * Can get the val_index value for the given key
+ * Can get the val_index value for the given key(key is case insensitive)
  * @returns value or null if not found
  */
 char* get_header(headers_t *headers, char *key, uint64_t val_index);
@@ -60,4 +99,13 @@ char* get_header(headers_t *headers, char *key, uint64_t val_index);
  * @returns number of values for a given key
  */
 uint64_t num_header_vals(headers_t *headers, char *key);
+
+/**
+ * Finds the next element of a comma separated header value(such as Connection: keep-alive, Upgrade), elements are
+ * separated by commas, spaces and tabs
+ * @param list the header value, then the returned element + len to continue
+ * @param len set to the length of the element(it is not null terminated)
+ * @returns the start of the element or null if there are no more
+ */
+const char* next_list_token(const char *list, uint64_t *len);
 #endif
\ No newline at end of file
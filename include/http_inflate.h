@@ -0,0 +1,73 @@
+#ifndef HTTP_INFLATE_H
+#define HTTP_INFLATE_H
+
+#include <zlib.h>
+#include "simple_http.h"
+
+/**
+ * Body stage that inflates Content-Encoding: gzip/deflate bodies as they arrive.
+ * The decompressed data is either passed to a callback in HTTP_INFLATE_CHUNK_SIZE pieces or written straight to a caller buffer.
+ * Output never goes past max_size(or the caller buffer), so a zip bomb fails with HTTP_OUT_OF_BOUNDS before any more memory is used.
+ */
+
+#ifndef HTTP_INFLATE_CHUNK_SIZE
+    #define HTTP_INFLATE_CHUNK_SIZE 4096
+#endif
+
+/**
+ * Called with each piece of decompressed data
+ * @returns false to stop parsing
+ */
+typedef bool (*http_inflate_callback)(const uint8_t *data, uint64_t len, void *user);
+
+typedef struct {
+    z_stream stream;
+    //If inflateInit2 was called on stream
+    bool active;
+    //If the end of the compressed data was found
+    bool done;
+    //Max number of decompressed bytes
+    uint64_t max_size;
+    //Number of decompressed bytes so far
+    uint64_t total_out;
+    http_inflate_callback on_data;
+    void *user;
+    //Caller buffer, used instead of on_data if set
+    uint8_t *dest;
+    uint64_t dest_len;
+    //HTTP_OUT_OF_BOUNDS if max_size was passed, HTTP_INVALID_BODY if the data is corrupt or cut off, HTTP_OUT_OF_MEM if zlib could not allocate
+    http_response_error error;
+    //Where output goes once the limit is reached, if anything is written here the limit was passed
+    uint8_t overflow;
+    uint8_t chunk[HTTP_INFLATE_CHUNK_SIZE];
+} http_inflate_t;
+
+/**
+ * Allocates memory for http_inflate_t
+ * @param max_size max number of decompressed bytes
+ * @param on_data called with decompressed data, can be null if http_inflate_set_dest is used
+ * @param user passed to on_data
+ * @returns http_inflate_t or null if malloc failed
+ */
+http_inflate_t* http_inflate_init(uint64_t max_size, http_inflate_callback on_data, void *user);
+
+/**
+ * Free's http_inflate_t even in an unfinished state
+ */
+void http_inflate_free(http_inflate_t *inf);
+
+/**
+ * Writes the decompressed data to dest instead of on_data, inf -> total_out is the decompressed length once finished
+ * @param inf
+ * @param dest buffer to write to
+ * @param dest_len length of dest, more decompressed data than this is HTTP_OUT_OF_BOUNDS
+ */
+void http_inflate_set_dest(http_inflate_t *inf, uint8_t *dest, uint64_t dest_len);
+
+/**
+ * Creates a body stage that inflates bodies with Content-Encoding gzip or deflate, other bodies are stored as normal
+ * @see http_request_set_body_stage
+ */
+http_body_stage_t http_inflate_body_stage(http_inflate_t *inf);
+
+#endif
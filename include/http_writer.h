@@ -0,0 +1,121 @@
+#ifndef HTTP_WRITER_H
+#define HTTP_WRITER_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include "simple_http.h"
+
+/**
+ * http_writer_t builds a request or response as an iovec array that can be sent with a single writev.
+ * The iovecs point directly at the strings stored in http_request_t/headers_t(nothing is copied), so
+ * the request, headers and any added header strings must stay allocated until the write has finished.
+ */
+
+#ifndef HTTP_WRITER_MAX_ADDED_HEADERS
+    #define HTTP_WRITER_MAX_ADDED_HEADERS 8
+#endif
+
+#ifndef HTTP_WRITER_MAX_REMOVED_HEADERS
+    #define HTTP_WRITER_MAX_REMOVED_HEADERS 16
+#endif
+
+//Start line(up to 5 iovecs), 4 iovecs for each header(key, ": ", val, "\r\n"), end of headers and body
+#define HTTP_WRITER_MAX_IOV (5 + 4 * (HTTP_MAX_HEADERS + HTTP_WRITER_MAX_ADDED_HEADERS) + 2)
+
+/**
+ * HTTP_WRITER_OK: everything is normal
+ * HTTP_WRITER_OUT_OF_BOUNDS: too many headers were added or removed, or the message needs more than HTTP_WRITER_MAX_IOV iovecs
+ * HTTP_WRITER_INVALID: the request was not fully parsed, its body was streamed through a body stage or the status code is not 3 digits
+ */
+typedef enum {
+    HTTP_WRITER_OK,
+    HTTP_WRITER_OUT_OF_BOUNDS,
+    HTTP_WRITER_INVALID,
+} http_writer_error;
+
+/**
+ * Key of a stored header that is not written, not null terminated when it points into a Connection value
+ */
+typedef struct {
+    const char *key;
+    uint64_t key_len;
+} http_writer_removed_t;
+
+typedef struct {
+    //Pass to writev(fd, iov, iov_count)
+    struct iovec iov[HTTP_WRITER_MAX_IOV];
+    uint64_t iov_count;
+    //Headers written after the stored headers
+    header_entry_t added[HTTP_WRITER_MAX_ADDED_HEADERS];
+    uint64_t added_count;
+    //Keys of stored headers that will not be written(case insensitive)
+    http_writer_removed_t removed[HTTP_WRITER_MAX_REMOVED_HEADERS];
+    uint64_t removed_count;
+    //Storage for the version of the request line or the start of the status line
+    char start_line[16];
+} http_writer_t;
+
+/**
+ * Allocates memory for http_writer_t
+ * @returns http_writer_t or null if malloc failed
+ */
+http_writer_t* http_writer_init();
+
+/**
+ * Free's http_writer_t, does not free any of the strings it points to
+ */
+void http_writer_free(http_writer_t *writer);
+
+/**
+ * Clears the added and removed headers so the writer can be used for another message
+ */
+void http_writer_reset(http_writer_t *writer);
+
+/**
+ * Adds a header that is written after the stored headers, key and val are not copied
+ * @returns HTTP_WRITER_OUT_OF_BOUNDS if HTTP_WRITER_MAX_ADDED_HEADERS was reached
+ */
+http_writer_error http_writer_add_header(http_writer_t *writer, char *key, char *val);
+
+/**
+ * Stops every stored header with the key 'key' from being written, key is not copied
+ * @returns HTTP_WRITER_OUT_OF_BOUNDS if HTTP_WRITER_MAX_REMOVED_HEADERS was reached
+ */
+http_writer_error http_writer_remove_header(http_writer_t *writer, char *key);
+
+/**
+ * Removes the hop-by-hop headers(Connection, Keep-Alive, Proxy-Authenticate, Proxy-Authorization, TE, Trailer, Transfer-Encoding, Upgrade)
+ * and every header named in the Connection headers of 'headers'
+ * @param writer
+ * @param headers headers of the message being forwarded(Connection values are not copied), can be null
+ * @returns HTTP_WRITER_OUT_OF_BOUNDS if HTTP_WRITER_MAX_REMOVED_HEADERS was reached
+ */
+http_writer_error http_writer_remove_hop_by_hop(http_writer_t *writer, headers_t *headers);
+
+/**
+ * Builds writer -> iov from a parsed request
+ * @param writer
+ * @param req http_request_t in the HTTP_FINISHED or HTTP_UPGRADED state
+ * @returns HTTP_WRITER_INVALID if req was not finished or its body was streamed(not stored), HTTP_WRITER_OUT_OF_BOUNDS if it needs more than HTTP_WRITER_MAX_IOV iovecs
+ */
+http_writer_error http_writer_request(http_writer_t *writer, http_request_t *req);
+
+/**
+ * Builds writer -> iov for an HTTP/1.1 response
+ * @param writer
+ * @param status status code(100 - 999)
+ * @param reason reason phrase such as "OK"
+ * @param headers headers to write, can be null
+ * @param body body to write, can be null
+ * @param body_len length of body
+ * @returns HTTP_WRITER_INVALID if status is not 3 digits, HTTP_WRITER_OUT_OF_BOUNDS if headers needs more than HTTP_WRITER_MAX_IOV iovecs
+ */
+http_writer_error http_writer_response(http_writer_t *writer, uint16_t status, char *reason, headers_t *headers, uint8_t *body, uint64_t body_len);
+
+/**
+ * Moves writer -> iov past 'written' bytes so the rest can be sent after a partial writev
+ * @returns the number of iovecs left to write
+ */
+uint64_t http_writer_advance(http_writer_t *writer, uint64_t written);
+
+#endif
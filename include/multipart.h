@@ -0,0 +1,114 @@
+#ifndef MULTIPART_H
+#define MULTIPART_H
+
+#include "simple_http.h"
+
+/**
+ * Streaming multipart/form-data parser. Each part's headers are stored in a headers_t and its data is passed
+ * to a callback as it arrives, so no part is buffered. Can be attached to http_request_t as a body stage with
+ * multipart_body_stage or used on its own with multipart_set_boundary and parse_multipart.
+ */
+
+//Max boundary length allowed by RFC 2046
+#ifndef HTTP_MAX_BOUNDARY_SIZE
+    #define HTTP_MAX_BOUNDARY_SIZE 70
+#endif
+
+#ifndef HTTP_MAX_PART_HEADERS
+    #define HTTP_MAX_PART_HEADERS 8
+#endif
+
+//"\r\n--" + boundary
+#define MULTIPART_MAX_DELIM_SIZE (HTTP_MAX_BOUNDARY_SIZE + 4)
+
+/**
+ * The current state of the state machine when parsing a multipart body
+ * MULTIPART_PREAMBLE: Skipping everything before the first boundary
+ * MULTIPART_BOUNDARY_END: After a boundary, either -- for the last boundary or \r\n for a part
+ * MULTIPART_FINAL_DASH: The second - of the last boundary
+ * MULTIPART_BOUNDARY_LF: The \n after a boundary
+ * MULTIPART_HEADER_START: Allocation for the part's headers
+ * MULTIPART_HEADERS: Parsing the part's headers
+ * MULTIPART_DATA: Passing the part's data to on_part_data until the next boundary
+ * MULTIPART_EPILOGUE: Skipping everything after the last boundary, the body is complete
+ */
+typedef enum {
+    MULTIPART_ERROR,
+    MULTIPART_PREAMBLE,
+    MULTIPART_BOUNDARY_END,
+    MULTIPART_FINAL_DASH,
+    MULTIPART_BOUNDARY_LF,
+    MULTIPART_HEADER_START,
+    MULTIPART_HEADERS,
+    MULTIPART_DATA,
+    MULTIPART_EPILOGUE,
+} multipart_state;
+
+/**
+ * on_part_begin: Called once a part's headers are parsed, headers are freed after on_part_end
+ * on_part_data: Called with each piece of a part's data
+ * on_part_end: Called once a part's data has ended
+ * Each returns false to stop parsing(state becomes MULTIPART_ERROR/HTTP_INVALID_BODY), any of them can be null
+ */
+typedef struct {
+    bool (*on_part_begin)(headers_t *headers, void *user);
+    bool (*on_part_data)(const char *data, uint64_t len, void *user);
+    bool (*on_part_end)(void *user);
+    void *user;
+} multipart_callbacks_t;
+
+typedef struct {
+    multipart_callbacks_t callbacks;
+    multipart_state state;
+    //HTTP_OUT_OF_MEM, HTTP_OUT_OF_BOUNDS and HTTP_INVALID_HEADER come from the part headers, HTTP_INVALID_BODY for anything else
+    http_response_error error;
+    //Headers of the current part
+    headers_t *headers;
+    //State of the part header line being copied
+    _copy_state line;
+    //The delimiter that is searched for("\r\n--" + boundary)
+    char delim[MULTIPART_MAX_DELIM_SIZE];
+    uint64_t delim_len;
+    //Boyer-Moore-Horspool shift for each byte
+    uint8_t shift[256];
+    //How many bytes at the end of the last buf matched the start of delim, these have not been passed to on_part_data yet
+    uint64_t held;
+    //Used to search held bytes together with the start of the next buf
+    char window[2 * MULTIPART_MAX_DELIM_SIZE];
+} multipart_t;
+
+/**
+ * Allocates memory for multipart_t
+ * @param callbacks called for each part
+ * @returns multipart_t or null if malloc failed
+ */
+multipart_t* multipart_init(multipart_callbacks_t callbacks);
+
+/**
+ * Free's multipart_t even in an error state or an unfinished state
+ */
+void multipart_free(multipart_t *mp);
+
+/**
+ * Reads the boundary from a Content-Type header value and resets mp to parse a new body
+ * @param mp
+ * @param content_type such as "multipart/form-data; boundary=abc"
+ * @returns false if content_type is not multipart or the boundary is missing or longer than HTTP_MAX_BOUNDARY_SIZE
+ */
+bool multipart_set_boundary(multipart_t *mp, const char *content_type);
+
+/**
+ * Parses a chunk of a multipart body, calling the callbacks for each part
+ * @param mp multipart_t with a boundary set by multipart_set_boundary
+ * @param buf A chunk of the body
+ * @param buf_len Length of buf
+ */
+void parse_multipart(multipart_t *mp, const char *buf, uint64_t buf_len);
+
+/**
+ * Creates a body stage that streams multipart/form-data bodies through mp, other bodies are stored as normal
+ * @see http_request_set_body_stage
+ */
+http_body_stage_t multipart_body_stage(multipart_t *mp);
+
+#endif
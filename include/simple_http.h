@@ -2,26 +2,24 @@
 #define SIMPLE_HTTP_H
 
 #include <stdint.h>
-#include "headers.h"
-
-#ifndef HTTP_MAX_BODY_SIZE
-    #define HTTP_MAX_BODY_SIZE 2048
-#endif
 
-#ifndef HTTP_MAX_HEADER_KEY_SIZE
-    #define HTTP_MAX_HEADER_KEY_SIZE 255
-#endif
-
-#ifndef HTTP_MAX_HEADER_VAL_SIZE
-    #define HTTP_MAX_HEADER_VAL_SIZE 512
-#endif
+#include "simple_http_config.h"
+#include "headers.h"
 
-#ifndef HTTP_MAX_PATH_SIZE
-    #define HTTP_MAX_PATH_SIZE 30
-#endif
+/**
+ * Profile switches, none are set by default:
+ * HTTP_ALLOWED_METHODS: Bitmask of HTTP_METHOD_BIT(method), other methods are HTTP_INVALID_METHOD and never compared against
+ * HTTP_NO_BODY: The body states are compiled out, a request with a Content-Length body is HTTP_INVALID_BODY
+ * HTTP_FIXED_BUFFERS: The path and header line are copied into arrays inside _copy_state and headers are copied into slots
+ * allocated with headers_t(see header_slot_t) instead of being allocated
+ * HTTP_KNOWN_HEADERS: Comma separated lowercase header names(such as "host", "connection"), other headers are checked but not stored
+ * and still count towards HTTP_MAX_HEADERS.
+ * Content-Length is always stored
+ */
+#define HTTP_METHOD_BIT(method) (1u << (method))
 
-#ifndef HTTP_MAX_HEADERS
-    #define HTTP_MAX_HEADERS 30
+#ifndef HTTP_ALLOWED_METHODS
+    #define HTTP_ALLOWED_METHODS UINT32_MAX
 #endif
 
 /**
@@ -29,14 +27,37 @@
  * HTTP_OUT_OF_MEM: A malloc or calloc failed
  * HTTP_OUT_OF_BOUNDS: A values length surpassed a MAX macro
  * HTTP_INVALID_HEADER: Some part of the header is invalid(missing colon, no key, etc)
+ * HTTP_INVALID_METHOD: The method is not one of the methods in http_method
+ * HTTP_INVALID_VERSION: The version is not formatted as HTTP/<digit>.<digit>
+ * HTTP_INVALID_BODY: The body stage rejected the body(see the stage for more details)
  */
 typedef enum {
     HTTP_OK,
     HTTP_OUT_OF_MEM,
     HTTP_OUT_OF_BOUNDS,
     HTTP_INVALID_HEADER,
+    HTTP_INVALID_METHOD,
+    HTTP_INVALID_VERSION,
+    HTTP_INVALID_BODY,
 } http_response_error;
 
+/**
+ * Methods recognized by the parser, anything else is rejected with HTTP_INVALID_METHOD
+ * HTTP_METHOD_NONE: The method has not been parsed yet
+ */
+typedef enum {
+    HTTP_METHOD_NONE,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_DELETE,
+    HTTP_CONNECT,
+    HTTP_OPTIONS,
+    HTTP_TRACE,
+    HTTP_PATCH,
+} http_method;
+
 /**
  * The current state of the state machine when parsing an http request
  * STATE_START prefix is usually used for allocating memory on heap
@@ -54,7 +75,8 @@ typedef enum {
     HTTP_HEADER_FIND_AND_PARSE,
     HTTP_BODY_START, 
     HTTP_BODY,
-    HTTP_FINISHED
+    HTTP_FINISHED,
+    HTTP_UPGRADED
 } http_response_state;
 
 /**
@@ -70,19 +92,54 @@ typedef struct {
     uint64_t store_index;
     //How much of the delimeter has been found in buf
     uint64_t search_index;
+    //Inline store_buf for the method and version so they don't need to be allocated
+    char token[8];
+    //Positions in store_buf found while copying a header line
+    uint64_t colon_index;
+    uint64_t value_start;
+    uint64_t value_end;
+    //If the body is being passed to the body stage instead of being stored
+    bool body_streamed;
+    //Header lines not stored because of HTTP_KNOWN_HEADERS, still counted towards HTTP_MAX_HEADERS
+    uint64_t skipped_headers;
+#ifdef HTTP_FIXED_BUFFERS
+    //Used instead of allocating the path and header line
+    char path[HTTP_MAX_PATH_SIZE + 1];
+    char line[HTTP_MAX_HEADER_KEY_SIZE + 1 + HTTP_MAX_HEADER_VAL_SIZE];
+#endif
 } _copy_state;
 
+struct _http_request;
+
 /**
- * Where all the parsed http request data is stored
+ * A stage the body can be streamed through instead of being stored in req -> body(such as multipart.h)
+ * begin: Called once the headers are parsed, returns 1 to stream the body through the stage, 0 to store the body as normal, -1 if the body is invalid
+ * write: Called with each piece of the body as it arrives, returns false if the body is invalid
+ * finish: Called once all Content-Length bytes have been written(can be null), returns false if the body is invalid
+ * stage: Passed to each function
  */
 typedef struct {
-    char* method;
+    int (*begin)(void *stage, struct _http_request *req);
+    bool (*write)(void *stage, const char *buf, uint64_t buf_len);
+    bool (*finish)(void *stage);
+    void *stage;
+} http_body_stage_t;
+
+/**
+ * Where all the parsed http request data is stored
+ */
+typedef struct _http_request {
+    http_method method;
     char* path;
-    char* version;
+    uint8_t version_major;
+    uint8_t version_minor;
     headers_t *headers;
     uint8_t *body;
+    uint64_t body_len;
     http_response_state state;
     http_response_error error;
+    //Set with http_request_set_body_stage
+    http_body_stage_t body_stage;
     _copy_state *_internal;
 } http_request_t;
 
@@ -98,12 +155,79 @@ http_request_t* http_request_init();
  */
 void http_request_free(http_request_t* req);
 
+/**
+ * @returns the method as a C string(such as "GET") or null for HTTP_METHOD_NONE
+ */
+const char* http_method_str(http_method method);
+
 /**
  * Parses buf and stores the parsed data in req
  * @param req http_request_t allocated by http_request_init
  * @param buf A chunk of a ascii buffer to be parsed
  * @param buf_len Length of buf(not including \0)
+ * @returns number of bytes of buf that were parsed, once req is HTTP_FINISHED or HTTP_UPGRADED everything from this offset on
+ * is the next pipelined request or the tunnel/WebSocket data
+ */
+uint64_t parse_http_request(http_request_t *req, const char* buf, uint64_t buf_len);
+
+/**
+ * Streams the body through 'stage' instead of storing it in req -> body, must be set before the headers are fully parsed.
+ * Streamed bodies can be up to HTTP_MAX_STREAMED_BODY_SIZE long.
+ * @param req http_request_t allocated by http_request_init
+ * @param stage functions and state of the stage
+ */
+void http_request_set_body_stage(http_request_t *req, http_body_stage_t stage);
+
+/**
+ * Gives where the rest of the body should be written so it can be received straight into req -> body(such as recv(fd, dest, remaining, 0))
+ * @param req http_request_t that has parsed all of the headers(state HTTP_BODY_START or HTTP_BODY)
+ * @param dest set to where the next body byte is stored, or null if the request is not receiving a body
+ * @returns number of body bytes still missing, 0 if the request is not receiving a body or the body is streamed through a body stage
+ * @note can change state to HTTP_ERROR if the body could not be allocated
+ */
+uint64_t http_body_dest(http_request_t *req, uint8_t **dest);
+
+/**
+ * Marks 'len' bytes written to the dest given by http_body_dest as received, changes state to HTTP_FINISHED(or HTTP_UPGRADED) once the body is complete
+ * @param req http_request_t in the HTTP_BODY state
+ * @param len number of bytes written(anything past the missing bytes is ignored)
+ */
+void http_body_commit(http_request_t *req, uint64_t len);
+
+/**
+ * Saves where req is in parsing(including anything partially copied) into buf without any pointers, so it can be restored
+ * on another thread or after req is freed. The body stage is not saved.
+ * @param req http_request_t allocated by http_request_init
+ * @param buf where to save, can be null to get the size needed
+ * @param buf_len length of buf
+ * @returns number of bytes needed(nothing is written if this is greater than buf_len), 0 if the body is being streamed through a body stage
+ */
+uint64_t http_request_save(http_request_t *req, uint8_t *buf, uint64_t buf_len);
+
+/**
+ * Creates an http_request_t from a snapshot saved by http_request_save, parse_http_request continues from where it was saved
+ * @param buf snapshot
+ * @param buf_len length of the snapshot
+ * @returns http_request_t or null if the snapshot is invalid or malloc failed
+ */
+http_request_t* http_request_restore(const uint8_t *buf, uint64_t buf_len);
+
+/**
+ * Internal, resets c to copy a header line(shared with multipart.c)
+ * @returns false if the line buffer could not be allocated
+ */
+bool _reset_header_line(_copy_state *c);
+
+/**
+ * Internal, frees c -> store_buf unless it is one of the inline buffers
+ */
+void _free_store_buf(_copy_state *c);
+
+/**
+ * Internal, copies a single header line from buf and stores it in headers(shared with multipart.c)
+ * @param known_only if headers not in HTTP_KNOWN_HEADERS are skipped(when it is defined)
+ * @returns 0 if the line has not ended, 1 if a header was stored(or skipped), 2 if the empty line ending the headers was found, -1 if an error occured(stored in error)
  */
-void parse_http_request(http_request_t *req, const char* buf, uint64_t buf_len);
+int _parse_header_line(_copy_state *c, headers_t *headers, bool known_only, const char *buf, uint64_t buf_len, uint64_t *it, http_response_error *error);
 
 #endif 
@@ -0,0 +1,35 @@
+#ifndef SIMPLE_HTTP_CONFIG_H
+#define SIMPLE_HTTP_CONFIG_H
+
+//A profile header(see profiles/) can set any of the macros below before the defaults are used
+#ifdef SIMPLE_HTTP_CONFIG
+    #include SIMPLE_HTTP_CONFIG
+#endif
+
+#ifndef HTTP_MAX_BODY_SIZE
+    #define HTTP_MAX_BODY_SIZE 2048
+#endif
+
+#ifndef HTTP_MAX_HEADER_KEY_SIZE
+    #define HTTP_MAX_HEADER_KEY_SIZE 255
+#endif
+
+#ifndef HTTP_MAX_HEADER_VAL_SIZE
+    #define HTTP_MAX_HEADER_VAL_SIZE 512
+#endif
+
+#ifndef HTTP_MAX_PATH_SIZE
+    #define HTTP_MAX_PATH_SIZE 30
+#endif
+
+#ifndef HTTP_MAX_HEADERS
+    #define HTTP_MAX_HEADERS 30
+#endif
+
+#ifndef HTTP_MAX_STREAMED_BODY_SIZE
+    #define HTTP_MAX_STREAMED_BODY_SIZE 1073741824
+#endif
+
+#include "simple_http_prefix.h"
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SIMPLE_HTTP_PREFIX_H
+#define SIMPLE_HTTP_PREFIX_H
+
+/**
+ * When SIMPLE_HTTP_PREFIX is defined(simple_http_add_profile sets it to the lowercase library name followed by _)
+ * every exported function and the types whose layout depends on the profile are renamed to start with it,
+ * so several profiles and SIMPLE_HTTP can be linked into one program. The names used in code don't change.
+ */
+#ifdef SIMPLE_HTTP_PREFIX
+
+#define SIMPLE_HTTP_CONCAT_(a, b) a##b
+#define SIMPLE_HTTP_CONCAT(a, b) SIMPLE_HTTP_CONCAT_(a, b)
+//The name isn't expanded again inside its own macro so it is only prefixed once
+#define SIMPLE_HTTP_NAME(name) SIMPLE_HTTP_CONCAT(SIMPLE_HTTP_PREFIX, name)
+
+//headers.h
+#define header_token_table SIMPLE_HTTP_NAME(header_token_table)
+#define headers_init SIMPLE_HTTP_NAME(headers_init)
+#define headers_free SIMPLE_HTTP_NAME(headers_free)
+#define add_header SIMPLE_HTTP_NAME(add_header)
+#define add_header_copy SIMPLE_HTTP_NAME(add_header_copy)
+#define get_last_header SIMPLE_HTTP_NAME(get_last_header)
+#define get_header SIMPLE_HTTP_NAME(get_header)
+#define num_header_vals SIMPLE_HTTP_NAME(num_header_vals)
+#define next_list_token SIMPLE_HTTP_NAME(next_list_token)
+
+//simple_http.h
+#define _copy_state SIMPLE_HTTP_NAME(_copy_state)
+#define http_method_str SIMPLE_HTTP_NAME(http_method_str)
+#define http_request_init SIMPLE_HTTP_NAME(http_request_init)
+#define http_request_free SIMPLE_HTTP_NAME(http_request_free)
+#define http_request_set_body_stage SIMPLE_HTTP_NAME(http_request_set_body_stage)
+#define http_body_dest SIMPLE_HTTP_NAME(http_body_dest)
+#define http_body_commit SIMPLE_HTTP_NAME(http_body_commit)
+#define parse_http_request SIMPLE_HTTP_NAME(parse_http_request)
+#define http_request_save SIMPLE_HTTP_NAME(http_request_save)
+#define http_request_restore SIMPLE_HTTP_NAME(http_request_restore)
+#define _reset_header_line SIMPLE_HTTP_NAME(_reset_header_line)
+#define _free_store_buf SIMPLE_HTTP_NAME(_free_store_buf)
+#define _parse_header_line SIMPLE_HTTP_NAME(_parse_header_line)
+
+//http_writer.h
+#define http_writer_t SIMPLE_HTTP_NAME(http_writer_t)
+#define http_writer_init SIMPLE_HTTP_NAME(http_writer_init)
+#define http_writer_free SIMPLE_HTTP_NAME(http_writer_free)
+#define http_writer_reset SIMPLE_HTTP_NAME(http_writer_reset)
+#define http_writer_add_header SIMPLE_HTTP_NAME(http_writer_add_header)
+#define http_writer_remove_header SIMPLE_HTTP_NAME(http_writer_remove_header)
+#define http_writer_remove_hop_by_hop SIMPLE_HTTP_NAME(http_writer_remove_hop_by_hop)
+#define http_writer_request SIMPLE_HTTP_NAME(http_writer_request)
+#define http_writer_response SIMPLE_HTTP_NAME(http_writer_response)
+#define http_writer_advance SIMPLE_HTTP_NAME(http_writer_advance)
+
+//multipart.h
+#define multipart_t SIMPLE_HTTP_NAME(multipart_t)
+#define multipart_init SIMPLE_HTTP_NAME(multipart_init)
+#define multipart_free SIMPLE_HTTP_NAME(multipart_free)
+#define multipart_set_boundary SIMPLE_HTTP_NAME(multipart_set_boundary)
+#define multipart_body_stage SIMPLE_HTTP_NAME(multipart_body_stage)
+#define parse_multipart SIMPLE_HTTP_NAME(parse_multipart)
+
+//http_inflate.h
+#define http_inflate_init SIMPLE_HTTP_NAME(http_inflate_init)
+#define http_inflate_free SIMPLE_HTTP_NAME(http_inflate_free)
+#define http_inflate_set_dest SIMPLE_HTTP_NAME(http_inflate_set_dest)
+#define http_inflate_body_stage SIMPLE_HTTP_NAME(http_inflate_body_stage)
+
+#endif
+
+#endif
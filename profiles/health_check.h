@@ -0,0 +1,21 @@
+#ifndef SIMPLE_HTTP_HEALTH_CHECK_H
+#define SIMPLE_HTTP_HEALTH_CHECK_H
+
+/**
+ * Profile for health check and metrics endpoints: GET/HEAD only, no bodies, at most 16 headers and only the headers
+ * those endpoints look at are stored. http_request_init makes 3 allocations(the request, its header table and parser state)
+ * and parse_http_request makes none.
+ * Built with simple_http_add_profile(SIMPLE_HTTP_HEALTH_CHECK ${CMAKE_CURRENT_SOURCE_DIR}/profiles/health_check.h)
+ */
+
+#define HTTP_ALLOWED_METHODS (HTTP_METHOD_BIT(HTTP_GET) | HTTP_METHOD_BIT(HTTP_HEAD))
+#define HTTP_NO_BODY
+#define HTTP_FIXED_BUFFERS
+#define HTTP_KNOWN_HEADERS "host", "connection", "user-agent", "accept"
+
+#define HTTP_MAX_HEADERS 16
+#define HTTP_MAX_PATH_SIZE 64
+#define HTTP_MAX_HEADER_KEY_SIZE 32
+#define HTTP_MAX_HEADER_VAL_SIZE 256
+
+#endif
@@ -1,13 +1,122 @@
 #include <string.h>
+#include <strings.h>
 #include "headers.h"
 
-//djb2 hash function for strings
+const unsigned char header_token_table[256] = {
+    ['!'] = '!', ['#'] = '#', ['$'] = '$', ['%'] = '%', ['&'] = '&', ['\''] = '\'', ['*'] = '*',
+    ['+'] = '+', ['-'] = '-', ['.'] = '.', ['^'] = '^', ['_'] = '_', ['`'] = '`', ['|'] = '|', ['~'] = '~',
+    ['0'] = '0', ['1'] = '1', ['2'] = '2', ['3'] = '3', ['4'] = '4', ['5'] = '5', ['6'] = '6', ['7'] = '7', ['8'] = '8', ['9'] = '9',
+    ['A'] = 'a', ['B'] = 'b', ['C'] = 'c', ['D'] = 'd', ['E'] = 'e', ['F'] = 'f', ['G'] = 'g', ['H'] = 'h', ['I'] = 'i',
+    ['J'] = 'j', ['K'] = 'k', ['L'] = 'l', ['M'] = 'm', ['N'] = 'n', ['O'] = 'o', ['P'] = 'p', ['Q'] = 'q', ['R'] = 'r',
+    ['S'] = 's', ['T'] = 't', ['U'] = 'u', ['V'] = 'v', ['W'] = 'w', ['X'] = 'x', ['Y'] = 'y', ['Z'] = 'z',
+    ['a'] = 'a', ['b'] = 'b', ['c'] = 'c', ['d'] = 'd', ['e'] = 'e', ['f'] = 'f', ['g'] = 'g', ['h'] = 'h', ['i'] = 'i',
+    ['j'] = 'j', ['k'] = 'k', ['l'] = 'l', ['m'] = 'm', ['n'] = 'n', ['o'] = 'o', ['p'] = 'p', ['q'] = 'q', ['r'] = 'r',
+    ['s'] = 's', ['t'] = 't', ['u'] = 'u', ['v'] = 'v', ['w'] = 'w', ['x'] = 'x', ['y'] = 'y', ['z'] = 'z',
+};
+
+#ifdef HTTP_FIXED_BUFFERS
+
+headers_t* headers_init(uint64_t max_headers) {
+    //The entries and slots are part of the same allocation so adding a header never allocates
+    headers_t *temp = calloc(1, sizeof(headers_t) + max_headers * (sizeof(header_entry_t) + sizeof(header_slot_t)));
+
+    if(!temp) {
+        return 0;
+    }
+
+    temp -> max_headers = max_headers;
+    temp -> header_count = 0;
+    temp -> entries = (header_entry_t*) (temp + 1);
+    temp -> slots = (header_slot_t*) (temp -> entries + max_headers);
+
+    return temp;
+}
+
+void headers_free(headers_t *headers) {
+    free(headers);
+}
+
+headers_state add_header_copy(headers_t *headers, const char *key, uint64_t key_len, const char *val, uint64_t val_len) {
+    if(headers -> header_count == headers -> max_headers) {
+        return HEADERS_OUT_OF_BOUNDS;
+    }
+
+    if(key_len > HTTP_MAX_HEADER_KEY_SIZE || val_len > HTTP_MAX_HEADER_VAL_SIZE) {
+        return HEADERS_OUT_OF_BOUNDS;
+    }
+
+    header_slot_t *slot = &headers -> slots[headers -> header_count];
+    memcpy(slot -> key, key, key_len);
+    slot -> key[key_len] = '\0';
+    memcpy(slot -> val, val, val_len);
+    slot -> val[val_len] = '\0';
+
+    headers -> entries[headers -> header_count].key = slot -> key;
+    headers -> entries[headers -> header_count].val = slot -> val;
+    headers -> header_count++;
+    return HEADERS_OK_ERROR;
+}
+
+headers_state add_header(headers_t *headers, char *key, char *val) {
+    headers_state state = add_header_copy(headers, key, strlen(key), val, strlen(val));
+
+    //headers_t owns key and val once they are added, they were copied into a slot so they aren't needed
+    if(state == HEADERS_OK_ERROR) {
+        free(key);
+        free(val);
+    }
+
+    return state;
+}
+
+char* get_last_header(headers_t *headers, char *key) {
+    for(uint64_t i = headers -> header_count; i > 0; i--) {
+        if(strcasecmp(headers -> entries[i - 1].key, key) == 0) {
+            return headers -> entries[i - 1].val;
+        }
+    }
+
+    return 0;
+}
+
+char* get_header(headers_t *headers, char *key, uint64_t val_index) {
+    for(uint64_t i = 0; i < headers -> header_count; i++) {
+        if(strcasecmp(headers -> entries[i].key, key) == 0) {
+            if(val_index == 0) {
+                return headers -> entries[i].val;
+            }
+            val_index--;
+        }
+    }
+
+    return 0;
+}
+
+uint64_t num_header_vals(headers_t *headers, char *key) {
+    uint64_t count = 0;
+
+    for(uint64_t i = 0; i < headers -> header_count; i++) {
+        if(strcasecmp(headers -> entries[i].key, key) == 0) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+#else
+
+//djb2 hash function for strings, case insensitive so lookups can use any casing of the key
 static uint64_t string_hash(void *key) {
     unsigned char *str = (unsigned char*) key;
     unsigned long hash = 5381;
     int c;
 
     while((c = *str++)) {
+        //Keys stored by the parser are already lowercase, only lookup keys need folding
+        if(header_token_table[c]) {
+            c = header_token_table[c];
+        }
         hash = ((hash << 5) + hash) + c;
     }
 
@@ -16,7 +125,7 @@ static uint64_t string_hash(void *key) {
 
 
 static bool string_equal(void *a, void *b) {
-    return strcmp((char*)a, (char*)b) == 0;
+    return strcasecmp((char*)a, (char*)b) == 0;
 }
 
 /**
@@ -53,6 +162,14 @@ headers_t* headers_init(uint64_t max_headers) {
         free(temp);
         return 0;
     }
+
+    temp -> entries = malloc(max_headers * sizeof(header_entry_t));
+
+    if(!temp -> entries) {
+        hashmap_free(temp -> headers, _headers_free, 0);
+        free(temp);
+        return 0;
+    }
     
     return temp;
 }
@@ -65,6 +182,7 @@ void headers_free(headers_t *headers) {
         if(headers -> headers) {
             hashmap_free(headers -> headers, _headers_free, 0);
         }
+        free(headers -> entries);
         free(headers);
     } 
 }
@@ -120,12 +238,40 @@ headers_state add_header(headers_t *headers, char *key, char *val) {
         if(array -> error) {
             return HEADERS_OUT_OF_MEM;
         }
+        //The key is already stored in the pair
+        free(key);
     }
 
+    headers -> entries[headers -> header_count].key = pair -> key;
+    headers -> entries[headers -> header_count].val = val;
     headers -> header_count++;
     return HEADERS_OK_ERROR;
 }
 
+headers_state add_header_copy(headers_t *headers, const char *key, uint64_t key_len, const char *val, uint64_t val_len) {
+    char *key_copy = malloc(key_len + 1);
+    char *val_copy = malloc(val_len + 1);
+
+    if(!key_copy || !val_copy) {
+        free(key_copy);
+        free(val_copy);
+        return HEADERS_OUT_OF_MEM;
+    }
+
+    memcpy(key_copy, key, key_len);
+    key_copy[key_len] = '\0';
+    memcpy(val_copy, val, val_len);
+    val_copy[val_len] = '\0';
+
+    headers_state state = add_header(headers, key_copy, val_copy);
+    if(state != HEADERS_OK_ERROR) {
+        free(key_copy);
+        free(val_copy);
+    }
+
+    return state;
+}
+
 char* get_last_header(headers_t *headers, char *key) {
     hashmap_pair_t *pair = hashmap_get(headers -> headers, key);
     if(!pair) {
@@ -173,3 +319,17 @@ uint64_t num_header_vals(headers_t *headers, char *key) {
     return array -> size;
 }
 
+#endif
+
+const char* next_list_token(const char *list, uint64_t *len) {
+    while(*list == ' ' || *list == '\t' || *list == ',') {
+        list++;
+    }
+
+    *len = 0;
+    while(list[*len] && list[*len] != ',' && list[*len] != ' ' && list[*len] != '\t') {
+        (*len)++;
+    }
+
+    return *len > 0 ? list : 0;
+}
@@ -0,0 +1,183 @@
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include "http_inflate.h"
+
+static bool set_error(http_inflate_t *inf, http_response_error error) {
+    inf -> error = error;
+    return false;
+}
+
+/**
+ * Gives where inflate should write next and how much space it has.
+ * Once the limit is reached output goes to inf -> overflow, so the limit is checked before anything is written past it.
+ */
+static uint64_t out_space(http_inflate_t *inf, uint8_t **out) {
+    uint64_t limit = inf -> max_size;
+    if(inf -> dest && inf -> dest_len < limit) {
+        limit = inf -> dest_len;
+    }
+
+    uint64_t left = limit - inf -> total_out;
+
+    if(left == 0) {
+        *out = &inf -> overflow;
+        return 1;
+    }
+
+    if(inf -> dest) {
+        *out = inf -> dest + inf -> total_out;
+        return left;
+    }
+
+    *out = inf -> chunk;
+    return left < HTTP_INFLATE_CHUNK_SIZE ? left : HTTP_INFLATE_CHUNK_SIZE;
+}
+
+http_inflate_t* http_inflate_init(uint64_t max_size, http_inflate_callback on_data, void *user) {
+    http_inflate_t *temp = calloc(1, sizeof(http_inflate_t));
+
+    if(!temp) {
+        return NULL;
+    }
+
+    temp -> max_size = max_size;
+    temp -> on_data = on_data;
+    temp -> user = user;
+
+    return temp;
+}
+
+void http_inflate_free(http_inflate_t *inf) {
+    if(inf) {
+        if(inf -> active) {
+            inflateEnd(&inf -> stream);
+        }
+        free(inf);
+    }
+}
+
+void http_inflate_set_dest(http_inflate_t *inf, uint8_t *dest, uint64_t dest_len) {
+    inf -> dest = dest;
+    inf -> dest_len = dest_len;
+}
+
+static int inflate_begin(void *stage, http_request_t *req) {
+    http_inflate_t *inf = stage;
+    char *encoding = get_header(req -> headers, "Content-Encoding", 0);
+    int window_bits;
+
+    //gzip adds 16 to the window bits so zlib expects a gzip header
+    if(encoding && (strcasecmp(encoding, "gzip") == 0 || strcasecmp(encoding, "x-gzip") == 0)) {
+        window_bits = 16 + MAX_WBITS;
+    }
+    else if(encoding && strcasecmp(encoding, "deflate") == 0) {
+        window_bits = MAX_WBITS;
+    }
+    //Anything else is stored as normal
+    else {
+        return 0;
+    }
+
+    if(inf -> active) {
+        inflateEnd(&inf -> stream);
+        inf -> active = false;
+    }
+
+    memset(&inf -> stream, 0, sizeof(z_stream));
+    inf -> done = false;
+    inf -> total_out = 0;
+    inf -> error = HTTP_OK;
+
+    if(inflateInit2(&inf -> stream, window_bits) != Z_OK) {
+        set_error(inf, HTTP_OUT_OF_MEM);
+        return -1;
+    }
+
+    inf -> active = true;
+    return 1;
+}
+
+static bool inflate_write(void *stage, const char *buf, uint64_t buf_len) {
+    http_inflate_t *inf = stage;
+
+    //Data after the end of the compressed stream
+    if(inf -> done) {
+        return buf_len == 0 || set_error(inf, HTTP_INVALID_BODY);
+    }
+
+    const char *next = buf;
+    uint64_t left = buf_len;
+    inf -> stream.avail_in = 0;
+
+    do {
+        //zlib's avail_in and avail_out are uInt so anything larger is given to it in pieces
+        if(inf -> stream.avail_in == 0 && left > 0) {
+            uInt in_len = left < UINT_MAX ? left : UINT_MAX;
+            inf -> stream.next_in = (Bytef*) next;
+            inf -> stream.avail_in = in_len;
+            next += in_len;
+            left -= in_len;
+        }
+
+        uint8_t *out;
+        uint64_t space = out_space(inf, &out);
+        if(space > UINT_MAX) {
+            space = UINT_MAX;
+        }
+
+        inf -> stream.next_out = out;
+        inf -> stream.avail_out = space;
+
+        int ret = inflate(&inf -> stream, Z_NO_FLUSH);
+
+        if(ret == Z_MEM_ERROR) {
+            return set_error(inf, HTTP_OUT_OF_MEM);
+        }
+        else if(ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            return set_error(inf, HTTP_INVALID_BODY);
+        }
+
+        uint64_t produced = space - inf -> stream.avail_out;
+
+        if(out == &inf -> overflow && produced > 0) {
+            return set_error(inf, HTTP_OUT_OF_BOUNDS);
+        }
+
+        if(out != &inf -> overflow) {
+            inf -> total_out += produced;
+
+            if(!inf -> dest && produced > 0 && inf -> on_data && !inf -> on_data(out, produced, inf -> user)) {
+                return set_error(inf, HTTP_INVALID_BODY);
+            }
+        }
+
+        if(ret == Z_STREAM_END) {
+            inf -> done = true;
+            return (inf -> stream.avail_in == 0 && left == 0) || set_error(inf, HTTP_INVALID_BODY);
+        }
+
+        //No progress can be made until more input arrives
+        if(ret == Z_BUF_ERROR) {
+            break;
+        }
+    } while(inf -> stream.avail_in > 0 || left > 0 || inf -> stream.avail_out == 0);
+
+    return true;
+}
+
+static bool inflate_finish(void *stage) {
+    http_inflate_t *inf = stage;
+
+    //The compressed data was cut off
+    if(!inf -> done) {
+        return set_error(inf, HTTP_INVALID_BODY);
+    }
+
+    return true;
+}
+
+http_body_stage_t http_inflate_body_stage(http_inflate_t *inf) {
+    http_body_stage_t stage = {inflate_begin, inflate_write, inflate_finish, inf};
+    return stage;
+}
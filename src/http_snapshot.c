@@ -0,0 +1,370 @@
+#include <string.h>
+#include "simple_http.h"
+
+//Changes whenever the saved layout changes so old snapshots are rejected
+#define SNAPSHOT_FORMAT 2
+
+//store_buf in a snapshot is either not allocated, the inline token or its own allocation
+#define SNAPSHOT_NO_BUF 0
+#define SNAPSHOT_TOKEN_BUF 1
+#define SNAPSHOT_HEAP_BUF 2
+
+/**
+ * Writes into buf while there is space, pos keeps counting past the end so the needed size is known
+ */
+typedef struct {
+    uint8_t *buf;
+    uint64_t buf_len;
+    uint64_t pos;
+} _snapshot_writer;
+
+/**
+ * Reads from buf, ok becomes false if anything is read past the end
+ */
+typedef struct {
+    const uint8_t *buf;
+    uint64_t buf_len;
+    uint64_t pos;
+    bool ok;
+} _snapshot_reader;
+
+static void put_bytes(_snapshot_writer *w, const void *data, uint64_t len) {
+    if(w -> buf && w -> pos + len <= w -> buf_len) {
+        memcpy(w -> buf + w -> pos, data, len);
+    }
+    w -> pos += len;
+}
+
+static void put_u8(_snapshot_writer *w, uint8_t val) {
+    put_bytes(w, &val, 1);
+}
+
+//Little endian so snapshots don't depend on the machine
+static void put_u64(_snapshot_writer *w, uint64_t val) {
+    uint8_t bytes[8];
+    for(int i = 0; i < 8; i++) {
+        bytes[i] = val >> (8 * i);
+    }
+    put_bytes(w, bytes, 8);
+}
+
+//Length followed by the string, a length of 0 means null
+static void put_str(_snapshot_writer *w, const char *str) {
+    if(!str) {
+        put_u64(w, 0);
+        return;
+    }
+
+    uint64_t len = strlen(str);
+    put_u64(w, len + 1);
+    put_bytes(w, str, len);
+}
+
+static const uint8_t* get_bytes(_snapshot_reader *r, uint64_t len) {
+    if(!r -> ok || len > r -> buf_len - r -> pos) {
+        r -> ok = false;
+        return 0;
+    }
+
+    const uint8_t *data = r -> buf + r -> pos;
+    r -> pos += len;
+    return data;
+}
+
+static uint8_t get_u8(_snapshot_reader *r) {
+    const uint8_t *data = get_bytes(r, 1);
+    return data ? data[0] : 0;
+}
+
+static uint64_t get_u64(_snapshot_reader *r) {
+    const uint8_t *data = get_bytes(r, 8);
+    uint64_t val = 0;
+
+    if(data) {
+        for(int i = 0; i < 8; i++) {
+            val |= (uint64_t) data[i] << (8 * i);
+        }
+    }
+    return val;
+}
+
+/**
+ * Reads a string written by put_str into a new allocation
+ * @param str set to the string or null
+ * @returns false if the snapshot is invalid or malloc failed
+ */
+static bool get_str(_snapshot_reader *r, char **str, uint64_t max_len) {
+    uint64_t len = get_u64(r);
+    *str = 0;
+
+    if(!r -> ok || len == 0) {
+        return r -> ok;
+    }
+
+    if(len - 1 > max_len) {
+        r -> ok = false;
+        return false;
+    }
+
+    const uint8_t *data = get_bytes(r, len - 1);
+    if(!data) {
+        return false;
+    }
+
+    *str = malloc(len);
+    if(!*str) {
+        return false;
+    }
+
+    memcpy(*str, data, len - 1);
+    (*str)[len - 1] = '\0';
+    return true;
+}
+
+uint64_t http_request_save(http_request_t *req, uint8_t *buf, uint64_t buf_len) {
+    _copy_state *c = req -> _internal;
+
+    //The body stage's state can't be saved
+    if(c -> body_streamed) {
+        return 0;
+    }
+
+    _snapshot_writer w = {buf, buf_len, 0};
+
+    put_u8(&w, SNAPSHOT_FORMAT);
+    put_u8(&w, req -> state);
+    put_u8(&w, req -> error);
+    put_u8(&w, req -> method);
+    put_u8(&w, req -> version_major);
+    put_u8(&w, req -> version_minor);
+    put_u64(&w, req -> body_len);
+
+    put_u64(&w, c -> store_buf_len);
+    put_u64(&w, c -> store_index);
+    put_u64(&w, c -> search_index);
+    put_u64(&w, c -> colon_index);
+    put_u64(&w, c -> value_start);
+    put_u64(&w, c -> value_end);
+    put_bytes(&w, c -> token, sizeof(c -> token));
+
+    //Only what has been copied so far is saved, not the whole allocation
+    if(!c -> store_buf) {
+        put_u8(&w, SNAPSHOT_NO_BUF);
+    }
+    else if(c -> store_buf == c -> token) {
+        put_u8(&w, SNAPSHOT_TOKEN_BUF);
+    }
+    else {
+        put_u8(&w, SNAPSHOT_HEAP_BUF);
+        put_bytes(&w, c -> store_buf, c -> store_index);
+    }
+
+    put_str(&w, req -> path);
+
+    put_u64(&w, req -> headers -> header_count);
+    for(uint64_t i = 0; i < req -> headers -> header_count; i++) {
+        put_str(&w, req -> headers -> entries[i].key);
+        put_str(&w, req -> headers -> entries[i].val);
+    }
+    put_u64(&w, c -> skipped_headers);
+
+    put_u8(&w, req -> body != 0);
+    if(req -> body) {
+        put_bytes(&w, req -> body, req -> body_len);
+    }
+
+    return w.pos;
+}
+
+/**
+ * Gives the buffer a copied store_buf is restored into, HTTP_FIXED_BUFFERS uses the inline path and line buffers
+ * @returns the buffer or null if calloc failed
+ */
+static char* restore_store_buf(http_request_t *req, uint64_t line_len) {
+#ifdef HTTP_FIXED_BUFFERS
+    if(req -> state == HTTP_PATH) {
+        return req -> _internal -> path;
+    }
+    if(req -> state == HTTP_HEADER_START || req -> state == HTTP_HEADER_FIND_AND_PARSE) {
+        return req -> _internal -> line;
+    }
+#endif
+
+    //Zeroed so the path stays null terminated, at least a header line long since the header line buffer is reused
+    uint64_t len = req -> _internal -> store_buf_len > line_len ? req -> _internal -> store_buf_len : line_len;
+    return calloc(len + 1, sizeof(char));
+}
+
+/**
+ * Restores everything in the snapshot after the format byte into req
+ * @returns false if the snapshot is invalid or malloc failed
+ */
+static bool restore(http_request_t *req, _snapshot_reader *r) {
+    _copy_state *c = req -> _internal;
+    uint64_t line_len = HTTP_MAX_HEADER_KEY_SIZE + 1 + HTTP_MAX_HEADER_VAL_SIZE;
+    uint64_t max_buf_len = line_len;
+    if(HTTP_MAX_PATH_SIZE > max_buf_len) {
+        max_buf_len = HTTP_MAX_PATH_SIZE;
+    }
+    if(HTTP_MAX_BODY_SIZE > max_buf_len) {
+        max_buf_len = HTTP_MAX_BODY_SIZE;
+    }
+
+    req -> state = get_u8(r);
+    req -> error = get_u8(r);
+    req -> method = get_u8(r);
+    req -> version_major = get_u8(r);
+    req -> version_minor = get_u8(r);
+    req -> body_len = get_u64(r);
+
+    c -> store_buf_len = get_u64(r);
+    c -> store_index = get_u64(r);
+    c -> search_index = get_u64(r);
+    c -> colon_index = get_u64(r);
+    c -> value_start = get_u64(r);
+    c -> value_end = get_u64(r);
+
+    const uint8_t *token = get_bytes(r, sizeof(c -> token));
+    uint8_t buf_type = get_u8(r);
+
+    //search_index has to be shorter than the delimiter being searched for, header lines also use 2 for a finished \r\n
+    uint64_t max_search_index = 2;
+    if(req -> state == HTTP_METHOD || req -> state == HTTP_PATH) {
+        max_search_index = 0;
+    }
+    else if(req -> state == HTTP_VERSION) {
+        max_search_index = 1;
+    }
+
+    //store_buf_len is left over from a rejected Content-Length when there is no buffer, so it is only bounded with one
+    if(!token || req -> state > HTTP_UPGRADED || req -> error > HTTP_INVALID_BODY || req -> method > HTTP_PATCH
+       || req -> version_major > 9 || req -> version_minor > 9
+       || (buf_type != SNAPSHOT_NO_BUF && c -> store_buf_len > max_buf_len)
+       || c -> store_index > c -> store_buf_len || c -> search_index > max_search_index || c -> colon_index > c -> store_buf_len
+       || c -> value_start > c -> store_buf_len + 1 || c -> value_end > c -> store_buf_len) {
+        return false;
+    }
+    memcpy(c -> token, token, sizeof(c -> token));
+
+    //The state has to match the kind of store_buf it copies into, other states would overwrite(leak) an allocation
+    bool needs_token = req -> state == HTTP_METHOD || req -> state == HTTP_VERSION;
+    bool needs_heap = req -> state == HTTP_PATH || req -> state == HTTP_HEADER_FIND_AND_PARSE || req -> state == HTTP_BODY;
+    bool keeps_heap = needs_heap || req -> state == HTTP_HEADER_START || req -> state == HTTP_ERROR;
+    if(needs_token != (buf_type == SNAPSHOT_TOKEN_BUF) || (needs_heap && buf_type != SNAPSHOT_HEAP_BUF)
+       || (!keeps_heap && buf_type == SNAPSHOT_HEAP_BUF)
+       || (req -> state == HTTP_BODY && c -> store_buf_len != req -> body_len)
+       || (req -> state == HTTP_PATH && c -> store_buf_len > HTTP_MAX_PATH_SIZE)
+       || ((req -> state == HTTP_HEADER_START || req -> state == HTTP_HEADER_FIND_AND_PARSE) && c -> store_buf_len > line_len)) {
+        return false;
+    }
+
+    if(buf_type == SNAPSHOT_TOKEN_BUF) {
+        if(c -> store_buf_len > sizeof(c -> token)) {
+            return false;
+        }
+        c -> store_buf = c -> token;
+    }
+    else if(buf_type == SNAPSHOT_HEAP_BUF) {
+        const uint8_t *data = get_bytes(r, c -> store_index);
+        if(!data) {
+            return false;
+        }
+
+        c -> store_buf = restore_store_buf(req, line_len);
+        if(!c -> store_buf) {
+            return false;
+        }
+        memcpy(c -> store_buf, data, c -> store_index);
+    }
+    else if(buf_type != SNAPSHOT_NO_BUF) {
+        return false;
+    }
+
+    //The path is only set once it is parsed, before that it would be overwritten
+    if(!get_str(r, &req -> path, HTTP_MAX_PATH_SIZE)
+       || (req -> path && req -> state != HTTP_ERROR && req -> state < HTTP_VERSION_START)) {
+        return false;
+    }
+
+#ifdef HTTP_FIXED_BUFFERS
+    if(req -> path) {
+        strcpy(c -> path, req -> path);
+        free(req -> path);
+        req -> path = c -> path;
+    }
+#endif
+
+    uint64_t header_count = get_u64(r);
+    if(header_count > req -> headers -> max_headers) {
+        return false;
+    }
+
+    for(uint64_t i = 0; i < header_count; i++) {
+        char *key, *val;
+        if(!get_str(r, &key, HTTP_MAX_HEADER_KEY_SIZE)) {
+            return false;
+        }
+        if(!get_str(r, &val, HTTP_MAX_HEADER_VAL_SIZE) || !key || !val) {
+            free(key);
+            free(val);
+            return false;
+        }
+        if(add_header(req -> headers, key, val) != HEADERS_OK_ERROR) {
+            free(key);
+            free(val);
+            return false;
+        }
+    }
+
+    c -> skipped_headers = get_u64(r);
+    if(c -> skipped_headers > req -> headers -> max_headers - header_count) {
+        return false;
+    }
+
+    //The body states read the Content-Length header
+    bool body_state = req -> state == HTTP_BODY_START || req -> state == HTTP_BODY;
+#ifdef HTTP_NO_BODY
+    if(body_state) {
+        return false;
+    }
+#endif
+    if(body_state && !get_last_header(req -> headers, "Content-Length")) {
+        return false;
+    }
+
+    if(get_u8(r)) {
+        const uint8_t *data = get_bytes(r, req -> body_len);
+        if(!data || req -> body_len > HTTP_MAX_BODY_SIZE || (req -> state != HTTP_FINISHED && req -> state != HTTP_UPGRADED)) {
+            return false;
+        }
+
+        req -> body = malloc(req -> body_len + 1);
+        if(!req -> body) {
+            return false;
+        }
+        memcpy(req -> body, data, req -> body_len);
+        req -> body[req -> body_len] = '\0';
+    }
+
+    return r -> ok;
+}
+
+http_request_t* http_request_restore(const uint8_t *buf, uint64_t buf_len) {
+    _snapshot_reader r = {buf, buf_len, 0, true};
+
+    if(get_u8(&r) != SNAPSHOT_FORMAT) {
+        return NULL;
+    }
+
+    http_request_t *req = http_request_init();
+    if(!req) {
+        return NULL;
+    }
+
+    if(!restore(req, &r)) {
+        http_request_free(req);
+        return NULL;
+    }
+
+    return req;
+}
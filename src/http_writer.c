@@ -0,0 +1,250 @@
+#include <string.h>
+#include <strings.h>
+#include "http_writer.h"
+
+static char *hop_by_hop[] = {
+    "Connection", "Keep-Alive", "Proxy-Authenticate", "Proxy-Authorization", "TE", "Trailer", "Transfer-Encoding", "Upgrade"
+};
+
+/**
+ * Appends a span to writer -> iov, empty spans are skipped
+ * @returns false if writer -> iov is full
+ */
+static bool push(http_writer_t *writer, const void *base, uint64_t len) {
+    if(len == 0) {
+        return true;
+    }
+
+    if(writer -> iov_count == HTTP_WRITER_MAX_IOV) {
+        return false;
+    }
+
+    writer -> iov[writer -> iov_count].iov_base = (void*) base;
+    writer -> iov[writer -> iov_count].iov_len = len;
+    writer -> iov_count++;
+    return true;
+}
+
+/**
+ * @returns true if key was removed with http_writer_remove_header
+ */
+static bool is_removed(http_writer_t *writer, char *key) {
+    uint64_t key_len = strlen(key);
+
+    for(uint64_t i = 0; i < writer -> removed_count; i++) {
+        if(writer -> removed[i].key_len == key_len && strncasecmp(writer -> removed[i].key, key, key_len) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static http_writer_error remove_key(http_writer_t *writer, const char *key, uint64_t key_len) {
+    if(writer -> removed_count == HTTP_WRITER_MAX_REMOVED_HEADERS) {
+        return HTTP_WRITER_OUT_OF_BOUNDS;
+    }
+
+    writer -> removed[writer -> removed_count].key = key;
+    writer -> removed[writer -> removed_count].key_len = key_len;
+    writer -> removed_count++;
+
+    return HTTP_WRITER_OK;
+}
+
+/**
+ * Removes every header named in a Connection value(comma separated with optional spaces and tabs)
+ */
+static http_writer_error remove_connection_options(http_writer_t *writer, const char *list) {
+    uint64_t len;
+
+    for(const char *it = next_list_token(list, &len); it; it = next_list_token(it + len, &len)) {
+        http_writer_error err = remove_key(writer, it, len);
+        if(err != HTTP_WRITER_OK) {
+            return err;
+        }
+    }
+
+    return HTTP_WRITER_OK;
+}
+
+static bool push_header(http_writer_t *writer, header_entry_t *entry) {
+    return push(writer, entry -> key, strlen(entry -> key)) && push(writer, ": ", 2)
+           && push(writer, entry -> val, strlen(entry -> val)) && push(writer, "\r\n", 2);
+}
+
+/**
+ * Writes the stored headers that were not removed, the added headers and the end of the headers
+ * @returns false if writer -> iov is full
+ */
+static bool push_headers(http_writer_t *writer, headers_t *headers) {
+    if(headers) {
+        for(uint64_t i = 0; i < headers -> header_count; i++) {
+            if(!is_removed(writer, headers -> entries[i].key) && !push_header(writer, &headers -> entries[i])) {
+                return false;
+            }
+        }
+    }
+
+    for(uint64_t i = 0; i < writer -> added_count; i++) {
+        if(!push_header(writer, &writer -> added[i])) {
+            return false;
+        }
+    }
+
+    return push(writer, "\r\n", 2);
+}
+
+/**
+ * Clears a half built message so it can't be sent
+ */
+static http_writer_error out_of_bounds(http_writer_t *writer) {
+    writer -> iov_count = 0;
+    return HTTP_WRITER_OUT_OF_BOUNDS;
+}
+
+http_writer_t* http_writer_init() {
+    http_writer_t *temp = calloc(1, sizeof(http_writer_t));
+
+    if(!temp) {
+        return NULL;
+    }
+
+    return temp;
+}
+
+void http_writer_free(http_writer_t *writer) {
+    if(writer) {
+        free(writer);
+    }
+}
+
+void http_writer_reset(http_writer_t *writer) {
+    writer -> iov_count = 0;
+    writer -> added_count = 0;
+    writer -> removed_count = 0;
+}
+
+http_writer_error http_writer_add_header(http_writer_t *writer, char *key, char *val) {
+    if(writer -> added_count == HTTP_WRITER_MAX_ADDED_HEADERS) {
+        return HTTP_WRITER_OUT_OF_BOUNDS;
+    }
+
+    writer -> added[writer -> added_count].key = key;
+    writer -> added[writer -> added_count].val = val;
+    writer -> added_count++;
+
+    return HTTP_WRITER_OK;
+}
+
+http_writer_error http_writer_remove_header(http_writer_t *writer, char *key) {
+    return remove_key(writer, key, strlen(key));
+}
+
+http_writer_error http_writer_remove_hop_by_hop(http_writer_t *writer, headers_t *headers) {
+    for(uint64_t i = 0; i < sizeof(hop_by_hop) / sizeof(hop_by_hop[0]); i++) {
+        http_writer_error err = http_writer_remove_header(writer, hop_by_hop[i]);
+        if(err != HTTP_WRITER_OK) {
+            return err;
+        }
+    }
+
+    if(!headers) {
+        return HTTP_WRITER_OK;
+    }
+
+    //RFC 7230 6.1, headers listed in Connection only apply to this hop
+    for(uint64_t i = 0; i < num_header_vals(headers, "Connection"); i++) {
+        http_writer_error err = remove_connection_options(writer, get_header(headers, "Connection", i));
+        if(err != HTTP_WRITER_OK) {
+            return err;
+        }
+    }
+
+    return HTTP_WRITER_OK;
+}
+
+http_writer_error http_writer_request(http_writer_t *writer, http_request_t *req) {
+    if(req -> state != HTTP_FINISHED && req -> state != HTTP_UPGRADED) {
+        return HTTP_WRITER_INVALID;
+    }
+
+    //The body went through a body stage, forwarding the Content-Length without it would desync the connection
+    if(req -> body_len > 0 && !req -> body) {
+        return HTTP_WRITER_INVALID;
+    }
+
+    writer -> iov_count = 0;
+
+    const char *method = http_method_str(req -> method);
+    push(writer, method, strlen(method));
+    push(writer, " ", 1);
+    push(writer, req -> path, strlen(req -> path));
+
+    //" HTTP/x.y\r\n"
+    memcpy(writer -> start_line, " HTTP/x.y\r\n", 11);
+    writer -> start_line[6] = '0' + req -> version_major;
+    writer -> start_line[8] = '0' + req -> version_minor;
+    push(writer, writer -> start_line, 11);
+
+    if(!push_headers(writer, req -> headers)) {
+        return out_of_bounds(writer);
+    }
+
+    if(req -> body && !push(writer, req -> body, req -> body_len)) {
+        return out_of_bounds(writer);
+    }
+
+    return HTTP_WRITER_OK;
+}
+
+http_writer_error http_writer_response(http_writer_t *writer, uint16_t status, char *reason, headers_t *headers, uint8_t *body, uint64_t body_len) {
+    if(status < 100 || status > 999) {
+        return HTTP_WRITER_INVALID;
+    }
+
+    writer -> iov_count = 0;
+
+    //"HTTP/1.1 xxx "
+    memcpy(writer -> start_line, "HTTP/1.1 xxx ", 13);
+    writer -> start_line[9] = '0' + status / 100;
+    writer -> start_line[10] = '0' + status / 10 % 10;
+    writer -> start_line[11] = '0' + status % 10;
+    push(writer, writer -> start_line, 13);
+
+    if(reason) {
+        push(writer, reason, strlen(reason));
+    }
+    push(writer, "\r\n", 2);
+
+    if(!push_headers(writer, headers)) {
+        return out_of_bounds(writer);
+    }
+
+    if(body && !push(writer, body, body_len)) {
+        return out_of_bounds(writer);
+    }
+
+    return HTTP_WRITER_OK;
+}
+
+uint64_t http_writer_advance(http_writer_t *writer, uint64_t written) {
+    uint64_t i = 0;
+
+    //Skips every iovec that was fully written
+    while(i < writer -> iov_count && written >= writer -> iov[i].iov_len) {
+        written -= writer -> iov[i].iov_len;
+        i++;
+    }
+
+    //Moves the partially written iovec forward
+    if(i < writer -> iov_count) {
+        writer -> iov[i].iov_base = (char*) writer -> iov[i].iov_base + written;
+        writer -> iov[i].iov_len -= written;
+    }
+
+    memmove(writer -> iov, writer -> iov + i, (writer -> iov_count - i) * sizeof(struct iovec));
+    writer -> iov_count -= i;
+
+    return writer -> iov_count;
+}
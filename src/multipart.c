@@ -0,0 +1,333 @@
+#include <string.h>
+#include <strings.h>
+#include "multipart.h"
+
+static void set_error(multipart_t *mp, http_response_error error) {
+    mp -> state = MULTIPART_ERROR;
+    mp -> error = error;
+}
+
+/**
+ * Passes data to on_part_data, anything outside of a part(the preamble) is dropped
+ * @returns false if on_part_data stopped parsing
+ */
+static bool emit(multipart_t *mp, const char *data, uint64_t len, bool is_data) {
+    if(!is_data || len == 0 || !mp -> callbacks.on_part_data) {
+        return true;
+    }
+
+    return mp -> callbacks.on_part_data(data, len, mp -> callbacks.user);
+}
+
+/**
+ * Boyer-Moore-Horspool search for mp -> delim
+ * @returns index of the first match or -1 if not found
+ */
+static int64_t find_delim(multipart_t *mp, const char *buf, uint64_t buf_len) {
+    uint64_t n = mp -> delim_len;
+    if(buf_len < n) {
+        return -1;
+    }
+
+    uint64_t i = 0;
+    while(i <= buf_len - n) {
+        unsigned char last = buf[i + n - 1];
+        if(last == (unsigned char) mp -> delim[n - 1] && memcmp(buf + i, mp -> delim, n - 1) == 0) {
+            return i;
+        }
+        i += mp -> shift[last];
+    }
+
+    return -1;
+}
+
+/**
+ * Finds the first index from 'from' where the rest of buf is the start of delim(a match cut off by the end of buf)
+ * @returns the index or buf_len if the end of buf can't be the start of delim
+ */
+static uint64_t find_partial_delim(multipart_t *mp, const char *buf, uint64_t from, uint64_t buf_len) {
+    uint64_t i = buf_len >= mp -> delim_len ? buf_len - mp -> delim_len + 1 : 0;
+    if(i < from) {
+        i = from;
+    }
+
+    for(; i < buf_len; i++) {
+        if(memcmp(buf + i, mp -> delim, buf_len - i) == 0) {
+            return i;
+        }
+    }
+
+    return buf_len;
+}
+
+/**
+ * Searches buf for the delimiter, passing everything before it to on_part_data if is_data.
+ * Bytes at the end of buf that could be the start of the delimiter are held(not passed on) until the next buf.
+ * Since held bytes are always the start of delim they are not copied.
+ * @returns 1 if the delimiter was found(it is moved past it), 0 if buf ran out, -1 if on_part_data stopped parsing
+ */
+static int search_delim(multipart_t *mp, const char *buf, uint64_t buf_len, uint64_t *it, bool is_data) {
+    uint64_t n = mp -> delim_len;
+
+    //Checks if the held bytes and the start of buf make up the delimiter
+    if(mp -> held > 0) {
+        uint64_t held = mp -> held;
+        uint64_t take = buf_len - *it < n - 1 ? buf_len - *it : n - 1;
+
+        memcpy(mp -> window, mp -> delim, held);
+        memcpy(mp -> window + held, buf + *it, take);
+
+        int64_t found = find_delim(mp, mp -> window, held + take);
+        if(found >= 0 && (uint64_t) found < held) {
+            mp -> held = 0;
+            *it += found + n - held;
+            return emit(mp, mp -> delim, found, is_data) ? 1 : -1;
+        }
+
+        //Only happens if buf ran out before the delimiter could be ruled out
+        uint64_t partial = find_partial_delim(mp, mp -> window, 0, held + take);
+        if(partial < held) {
+            mp -> held = held + take - partial;
+            *it += take;
+            return emit(mp, mp -> delim, partial, is_data) ? 0 : -1;
+        }
+
+        mp -> held = 0;
+        if(!emit(mp, mp -> delim, held, is_data)) {
+            return -1;
+        }
+    }
+
+    int64_t found = find_delim(mp, buf + *it, buf_len - *it);
+    if(found >= 0) {
+        bool ok = emit(mp, buf + *it, found, is_data);
+        *it += found + n;
+        return ok ? 1 : -1;
+    }
+
+    uint64_t partial = find_partial_delim(mp, buf, *it, buf_len);
+    bool ok = emit(mp, buf + *it, partial - *it, is_data);
+    mp -> held = buf_len - partial;
+    *it = buf_len;
+    return ok ? 0 : -1;
+}
+
+/**
+ * Ends the current part and frees its headers
+ * @returns false if on_part_end stopped parsing
+ */
+static bool end_part(multipart_t *mp) {
+    bool ok = !mp -> callbacks.on_part_end || mp -> callbacks.on_part_end(mp -> callbacks.user);
+
+    headers_free(mp -> headers);
+    mp -> headers = 0;
+
+    return ok;
+}
+
+multipart_t* multipart_init(multipart_callbacks_t callbacks) {
+    multipart_t *temp = calloc(1, sizeof(multipart_t));
+
+    if(!temp) {
+        return NULL;
+    }
+
+    temp -> callbacks = callbacks;
+    //Has to be given a boundary before parsing
+    temp -> state = MULTIPART_ERROR;
+    temp -> error = HTTP_INVALID_BODY;
+
+    return temp;
+}
+
+void multipart_free(multipart_t *mp) {
+    if(mp) {
+        headers_free(mp -> headers);
+        _free_store_buf(&mp -> line);
+        free(mp);
+    }
+}
+
+bool multipart_set_boundary(multipart_t *mp, const char *content_type) {
+    headers_free(mp -> headers);
+    mp -> headers = 0;
+    mp -> state = MULTIPART_ERROR;
+    mp -> error = HTTP_INVALID_BODY;
+
+    if(strncasecmp(content_type, "multipart/", 10) != 0) {
+        return false;
+    }
+
+    //Finds the boundary parameter
+    const char *param = strchr(content_type, ';');
+    while(param) {
+        param++;
+        while(*param == ' ' || *param == '\t') {
+            param++;
+        }
+
+        if(strncasecmp(param, "boundary=", 9) == 0) {
+            break;
+        }
+        param = strchr(param, ';');
+    }
+
+    if(!param) {
+        return false;
+    }
+
+    const char *start = param + 9;
+    const char *end;
+    //The boundary can be quoted
+    if(*start == '"') {
+        start++;
+        end = strchr(start, '"');
+        if(!end) {
+            return false;
+        }
+    }
+    else {
+        end = start + strcspn(start, "; \t");
+    }
+
+    uint64_t boundary_len = end - start;
+    if(boundary_len == 0 || boundary_len > HTTP_MAX_BOUNDARY_SIZE) {
+        return false;
+    }
+
+    memcpy(mp -> delim, "\r\n--", 4);
+    memcpy(mp -> delim + 4, start, boundary_len);
+    mp -> delim_len = boundary_len + 4;
+
+    for(int i = 0; i < 256; i++) {
+        mp -> shift[i] = mp -> delim_len;
+    }
+    for(uint64_t i = 0; i < mp -> delim_len - 1; i++) {
+        mp -> shift[(unsigned char) mp -> delim[i]] = mp -> delim_len - 1 - i;
+    }
+
+    //The first boundary doesn't need a \r\n before it, so the body starts as if \r\n was already held
+    mp -> held = 2;
+    mp -> state = MULTIPART_PREAMBLE;
+    mp -> error = HTTP_OK;
+
+    return true;
+}
+
+void parse_multipart(multipart_t *mp, const char *buf, uint64_t buf_len) {
+    uint64_t i = 0;
+    int status;
+
+    while(i < buf_len) {
+        switch(mp -> state) {
+            case MULTIPART_PREAMBLE:
+                if(search_delim(mp, buf, buf_len, &i, false) == 1) {
+                    mp -> state = MULTIPART_BOUNDARY_END;
+                }
+                break;
+            case MULTIPART_BOUNDARY_END:
+                if(buf[i] == '-') {
+                    mp -> state = MULTIPART_FINAL_DASH;
+                }
+                else if(buf[i] == '\r') {
+                    mp -> state = MULTIPART_BOUNDARY_LF;
+                }
+                //Anything other than spaces and tabs(transport padding) is invalid
+                else if(buf[i] != ' ' && buf[i] != '\t') {
+                    set_error(mp, HTTP_INVALID_BODY);
+                    return;
+                }
+                i++;
+                break;
+            case MULTIPART_FINAL_DASH:
+                if(buf[i++] != '-') {
+                    set_error(mp, HTTP_INVALID_BODY);
+                    return;
+                }
+                mp -> state = MULTIPART_EPILOGUE;
+                break;
+            case MULTIPART_BOUNDARY_LF:
+                if(buf[i++] != '\n') {
+                    set_error(mp, HTTP_INVALID_BODY);
+                    return;
+                }
+                mp -> state = MULTIPART_HEADER_START;
+                break;
+            case MULTIPART_HEADER_START:
+                mp -> headers = headers_init(HTTP_MAX_PART_HEADERS);
+                if(!mp -> headers || !_reset_header_line(&mp -> line)) {
+                    set_error(mp, HTTP_OUT_OF_MEM);
+                    return;
+                }
+                mp -> state = MULTIPART_HEADERS;
+                break;
+            case MULTIPART_HEADERS:
+                status = _parse_header_line(&mp -> line, mp -> headers, false, buf, buf_len, &i, &mp -> error);
+                if(status == -1) {
+                    mp -> state = MULTIPART_ERROR;
+                    return;
+                }
+                else if(status == 1 && !_reset_header_line(&mp -> line)) {
+                    set_error(mp, HTTP_OUT_OF_MEM);
+                    return;
+                }
+                else if(status == 2) {
+                    if(mp -> callbacks.on_part_begin && !mp -> callbacks.on_part_begin(mp -> headers, mp -> callbacks.user)) {
+                        set_error(mp, HTTP_INVALID_BODY);
+                        return;
+                    }
+                    mp -> held = 0;
+                    mp -> state = MULTIPART_DATA;
+                }
+                break;
+            case MULTIPART_DATA:
+                status = search_delim(mp, buf, buf_len, &i, true);
+                if(status == -1 || (status == 1 && !end_part(mp))) {
+                    set_error(mp, HTTP_INVALID_BODY);
+                    return;
+                }
+                else if(status == 1) {
+                    mp -> state = MULTIPART_BOUNDARY_END;
+                }
+                break;
+            default:
+                //in case of MULTIPART_ERROR or MULTIPART_EPILOGUE
+                return;
+        }
+    }
+}
+
+static int multipart_begin(void *stage, http_request_t *req) {
+    char *content_type = get_header(req -> headers, "Content-Type", 0);
+
+    //Anything that isn't multipart is stored as normal
+    if(!content_type || strncasecmp(content_type, "multipart/", 10) != 0) {
+        return 0;
+    }
+
+    return multipart_set_boundary(stage, content_type) ? 1 : -1;
+}
+
+static bool multipart_write(void *stage, const char *buf, uint64_t buf_len) {
+    multipart_t *mp = stage;
+    parse_multipart(mp, buf, buf_len);
+
+    return mp -> state != MULTIPART_ERROR;
+}
+
+static bool multipart_finish(void *stage) {
+    multipart_t *mp = stage;
+
+    //The body ended before the last boundary
+    if(mp -> state != MULTIPART_EPILOGUE) {
+        set_error(mp, HTTP_INVALID_BODY);
+        return false;
+    }
+
+    return true;
+}
+
+http_body_stage_t multipart_body_stage(multipart_t *mp) {
+    http_body_stage_t stage = {multipart_begin, multipart_write, multipart_finish, mp};
+    return stage;
+}
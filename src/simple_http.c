@@ -1,4 +1,5 @@
 #include <string.h>
+#include <strings.h>
 #include "simple_http.h"
 
 /**
@@ -62,7 +63,9 @@ static void copy_to_delim(http_request_t *req, const char *buf, uint64_t buf_len
     int status = copy_to(buf, buf_len, delim, delim_len, req -> _internal, it);
     
     if(status == 1) {
+        //dest owns the memory now so http_request_free doesn't free it twice
         *dest = req -> _internal -> store_buf;
+        req -> _internal -> store_buf = 0;
         req -> state = next_state;
         (*it)++;
     }
@@ -72,6 +75,124 @@ static void copy_to_delim(http_request_t *req, const char *buf, uint64_t buf_len
     }
 }
 
+/**
+ * copy_to_delim for fields that are stored inline in _copy_state -> token instead of on the heap
+ * @param req
+ * @param buf buffer to parse
+ * @param buf_len length of 'buf'
+ * @param delim delimeter to search for
+ * @param delim_len delimeter string length
+ * @param it iterator for buf
+ * @returns 1 if delim was found and the token can be matched, else 0
+ * @note can change state to HTTP_ERROR/HTTP_OUT_OF_BOUNDS
+ */
+static int copy_token(http_request_t *req, const char *buf, uint64_t buf_len, char *delim, uint64_t delim_len, uint64_t *it) {
+    int status = copy_to(buf, buf_len, delim, delim_len, req -> _internal, it);
+
+    if(status == 1) {
+        req -> _internal -> store_buf = 0;
+        (*it)++;
+        return 1;
+    }
+    else if(status == -1) {
+        req -> _internal -> store_buf = 0;
+        req -> state = HTTP_ERROR;
+        req -> error = HTTP_OUT_OF_BOUNDS;
+    }
+
+    return 0;
+}
+
+/**
+ * Resets the _copy_state to copy into _copy_state -> token and transfers to next state
+ * @param req
+ * @param next_state state to transfer to
+ */
+static void reset_token(http_request_t *req, http_response_state next_state) {
+    req -> _internal -> store_index = 0;
+    req -> _internal -> search_index = 0;
+    req -> _internal -> store_buf_len = sizeof(req -> _internal -> token);
+    req -> _internal -> store_buf = req -> _internal -> token;
+    req -> state = next_state;
+}
+
+/**
+ * Matches a method token against the known methods, switching on length first so at most two compares are done
+ * @returns the method or HTTP_METHOD_NONE if it is not known
+ */
+static http_method match_method(const char *token, uint64_t len) {
+//Methods left out of HTTP_ALLOWED_METHODS are constant false so their compares are compiled out
+#define MATCH_METHOD(method, str) if((HTTP_ALLOWED_METHODS & HTTP_METHOD_BIT(method)) && memcmp(token, str, len) == 0) return method
+
+    switch(len) {
+        case 3:
+            MATCH_METHOD(HTTP_GET, "GET");
+            MATCH_METHOD(HTTP_PUT, "PUT");
+            break;
+        case 4:
+            MATCH_METHOD(HTTP_POST, "POST");
+            MATCH_METHOD(HTTP_HEAD, "HEAD");
+            break;
+        case 5:
+            MATCH_METHOD(HTTP_PATCH, "PATCH");
+            MATCH_METHOD(HTTP_TRACE, "TRACE");
+            break;
+        case 6:
+            MATCH_METHOD(HTTP_DELETE, "DELETE");
+            break;
+        case 7:
+            MATCH_METHOD(HTTP_OPTIONS, "OPTIONS");
+            MATCH_METHOD(HTTP_CONNECT, "CONNECT");
+            break;
+    }
+
+#undef MATCH_METHOD
+    return HTTP_METHOD_NONE;
+}
+
+/**
+ * Copies the method up to ' ' and matches it to http_method
+ * @note can change state to HTTP_ERROR/HTTP_OUT_OF_BOUNDS or HTTP_ERROR/HTTP_INVALID_METHOD
+ */
+static void parse_method(http_request_t *req, const char *buf, uint64_t buf_len, uint64_t *it) {
+    if(!copy_token(req, buf, buf_len, " ", 1, it)) {
+        return;
+    }
+
+    req -> method = match_method(req -> _internal -> token, req -> _internal -> store_index);
+
+    if(req -> method == HTTP_METHOD_NONE) {
+        req -> state = HTTP_ERROR;
+        req -> error = HTTP_INVALID_METHOD;
+        return;
+    }
+
+    req -> state = HTTP_PATH_START;
+}
+
+/**
+ * Copies the version up to \r\n and stores it as a major and minor number
+ * @note can change state to HTTP_ERROR/HTTP_OUT_OF_BOUNDS or HTTP_ERROR/HTTP_INVALID_VERSION
+ */
+static void parse_version(http_request_t *req, const char *buf, uint64_t buf_len, uint64_t *it) {
+    if(!copy_token(req, buf, buf_len, "\r\n", 2, it)) {
+        return;
+    }
+
+    char *token = req -> _internal -> token;
+    //Only HTTP/<digit>.<digit> is accepted
+    if(req -> _internal -> store_index != 8 || memcmp(token, "HTTP/", 5) != 0 || token[6] != '.'
+       || token[5] < '0' || token[5] > '9' || token[7] < '0' || token[7] > '9') {
+        req -> state = HTTP_ERROR;
+        req -> error = HTTP_INVALID_VERSION;
+        return;
+    }
+
+    req -> version_major = token[5] - '0';
+    req -> version_minor = token[7] - '0';
+    req -> state = HTTP_HEADER_START;
+}
+
 /**
  * Resets the _copy_state, allocates new memory to parse next field, and transfers to next state
  * @param req 
@@ -84,7 +205,13 @@ static void reset(http_request_t *req, uint64_t max_store_len, http_response_sta
     req -> _internal -> search_index = 0;
     req -> _internal -> store_buf_len = max_store_len;
 
+#ifdef HTTP_FIXED_BUFFERS
+    //Only used for the path
+    memset(req -> _internal -> path, 0, sizeof(req -> _internal -> path));
+    req -> _internal -> store_buf = req -> _internal -> path;
+#else
     req -> _internal -> store_buf = calloc(max_store_len + 1, sizeof(char));
+#endif
 
     if(req -> _internal -> store_buf) {
         req -> state = next_state;
@@ -95,118 +222,319 @@ static void reset(http_request_t *req, uint64_t max_store_len, http_response_sta
     }
 }
 
+bool _reset_header_line(_copy_state *c) {
+    c -> store_index = 0;
+    c -> search_index = 0;
+    c -> colon_index = 0;
+    c -> value_start = 0;
+    c -> value_end = 0;
+    c -> store_buf_len = HTTP_MAX_HEADER_KEY_SIZE + 1 + HTTP_MAX_HEADER_VAL_SIZE;
+
+    //The line buffer is only allocated for the first header and reused for the rest
+    if(!c -> store_buf) {
+#ifdef HTTP_FIXED_BUFFERS
+        c -> store_buf = c -> line;
+#else
+        c -> store_buf = malloc(c -> store_buf_len);
+#endif
+    }
+
+    return c -> store_buf != 0;
+}
+
+void _free_store_buf(_copy_state *c) {
+#ifdef HTTP_FIXED_BUFFERS
+    if(c -> store_buf == c -> path || c -> store_buf == c -> line) {
+        return;
+    }
+#endif
+
+    //store_buf points at token while the method or version is being copied
+    if(c -> store_buf != c -> token) {
+        free(c -> store_buf);
+    }
+}
+
 /**
- * Attempts to find a single header and parse it. Stores the header in req -> headers
- * @param req http_request_t
- * @param buf buffer to parse
- * @param buf_len length of buf
- * @param it iterator for buf
+ * Resets the _copy_state for the next header line and transfers to HTTP_HEADER_FIND_AND_PARSE
+ * @note can change state to HTTP_ERROR/HTTP_OUT_OF_MEM
  */
-static void find_and_parse_header(http_request_t *req, const char *buf, uint64_t buf_len, uint64_t *it) {
-    char *unparsed_header;
-    //Copies up to \r\n
-    copy_to_delim(req, buf, buf_len, "\r\n", 2, &unparsed_header, it, HTTP_HEADER_START);
-    //Doesn't start parsing the string until an error or \r\n is found in the buf
-    if(req -> state == HTTP_ERROR || req -> state == HTTP_HEADER_FIND_AND_PARSE) {
-        return;
+static void reset_header(http_request_t *req) {
+    if(_reset_header_line(req -> _internal)) {
+        req -> state = HTTP_HEADER_FIND_AND_PARSE;
     }
-    
-    //Checks if the end of headers has not been reached meaning buf found \r\n\r\n
-    if(req -> _internal -> store_index != 0) {
-        char *it_char;
-        //Finds everything up to the colon
-        char *temp = strtok_r(unparsed_header, ":", &it_char);
+    else {
+        req -> state = HTTP_ERROR;
+        req -> error = HTTP_OUT_OF_MEM;
+    }
+}
 
-        if(!temp) {
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_INVALID_HEADER;
-            return;
+/**
+ * Stores a single character of a header line, validating and lowercasing the key and
+ * recording where the colon, value start and value end(without OWS) are
+ * @returns 0 if stored, -1 if store_buf was filled, -2 if the header is invalid
+ */
+static int store_header_char(_copy_state *c, char ch) {
+    if(c -> store_index >= c -> store_buf_len) {
+        return -1;
+    }
+
+    if(!c -> colon_index) {
+        if(ch == ':') {
+            //no key?
+            if(c -> store_index == 0) {
+                return -2;
+            }
+            if(c -> store_index > HTTP_MAX_HEADER_KEY_SIZE) {
+                return -1;
+            }
+            c -> colon_index = c -> store_index;
+            c -> value_start = c -> store_index + 1;
+            c -> value_end = c -> value_start;
         }
-        //no key?
-        if(*it_char == '\0') {
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_INVALID_HEADER;
-            return;
+        else {
+            //Only token characters are allowed in the key
+            ch = header_token_table[(unsigned char) ch];
+            if(!ch) {
+                return -2;
+            }
         }
-        
-        long key_len = strlen(temp);
-        if(key_len > HTTP_MAX_HEADER_KEY_SIZE) {
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_OUT_OF_BOUNDS;
-            return;
+    }
+    else if(ch == ' ' || ch == '\t') {
+        //Skips spaces and tabs before the value, value_end is not moved so trailing spaces and tabs are trimmed
+        if(c -> value_start == c -> store_index) {
+            c -> value_start++;
         }
+    }
+    //Control characters(other than tab) are not allowed in a value, a NUL would also cut the stored value short
+    else if((unsigned char) ch < 0x20 || ch == 0x7f) {
+        return -2;
+    }
+    else {
+        c -> value_end = c -> store_index + 1;
+    }
 
-        char *key = malloc(key_len + 1);
-        if(!key) {
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_OUT_OF_MEM;
-            return;
-        }
+    c -> store_buf[c -> store_index++] = ch;
+    return 0;
+}
 
-        key = strcpy(key, temp);
-        //Does not copy all the spaces and tabs before the value
-        while((*it_char == ' ' || *it_char == '\t') && *it_char != '\0') {
-            it_char++;
-        }
+/**
+ * Copies a single header line into c -> store_buf, tokenising it in the same pass.
+ * search_index is 1 after a \r and 2 after \r\n, a header line is only finished once the next character is
+ * known not to be a space or tab, else the line is folded(obs-fold) into the value as spaces.
+ * @returns 0 if the line has not ended, 1 if it ended(store_index is 0 for the empty line), -1 if store_buf was filled, -2 if the header is invalid
+ */
+static int copy_header_line(const char *buf, uint64_t buf_len, _copy_state *c, uint64_t *it) {
+    while(*it < buf_len) {
+        char ch = buf[*it];
 
-        //no value?
-        if(*it_char == '\0') {
-            free(key);
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_INVALID_HEADER;
-            return;
+        if(c -> search_index == 2) {
+            if(ch != ' ' && ch != '\t') {
+                return 1;
+            }
+            //obs-fold, the whitespace is stored as spaces inside the value
+            c -> search_index = 0;
+            ch = ' ';
         }
-        
-        long val_len = strlen(it_char); 
-
-        if(val_len > HTTP_MAX_HEADER_VAL_SIZE) {
-            free(key);
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_OUT_OF_BOUNDS;
-            return;
+        else if(c -> search_index == 1) {
+            if(ch == '\n') {
+                c -> search_index = 2;
+                (*it)++;
+                //The empty line ends the headers so there is nothing to fold
+                if(c -> store_index == 0) {
+                    return 1;
+                }
+                //missing colon
+                if(!c -> colon_index) {
+                    return -2;
+                }
+                continue;
+            }
+            //A \r on its own is invalid(RFC 9112 2.2), it could be forwarded as a line break
+            return -2;
         }
-        char *val = malloc(val_len + 1);
 
-        if(!val) {
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_OUT_OF_MEM;
-            return;
+        if(ch == '\r') {
+            c -> search_index = 1;
+        }
+        else {
+            int status = store_header_char(c, ch);
+            if(status != 0) {
+                return status;
+            }
         }
 
-        strcpy(val, it_char);
-        headers_state ht = add_header(req -> headers, key, val);
-        if(ht == HEADERS_OUT_OF_MEM) {
-            free(key);
-            free(val);
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_OUT_OF_MEM;
-            return;
+        (*it)++;
+    }
+
+    return 0;
+}
+
+#ifdef HTTP_KNOWN_HEADERS
+static const char *known_headers[] = {"content-length", HTTP_KNOWN_HEADERS};
+
+/**
+ * Checks a lowercased key against HTTP_KNOWN_HEADERS, Content-Length is always known so the body is still found
+ */
+static bool is_known_header(const char *key, uint64_t key_len) {
+    for(uint64_t i = 0; i < sizeof(known_headers) / sizeof(known_headers[0]); i++) {
+        if(strlen(known_headers[i]) == key_len && memcmp(known_headers[i], key, key_len) == 0) {
+            return true;
         }
+    }
+
+    return false;
+}
+#endif
+
+int _parse_header_line(_copy_state *c, headers_t *headers, bool known_only, const char *buf, uint64_t buf_len, uint64_t *it, http_response_error *error) {
+    int status = copy_header_line(buf, buf_len, c, it);
+
+    //Doesn't start parsing the header until an error or the end of the line is found in the buf
+    if(status == 0) {
+        return 0;
+    }
+    else if(status == -1) {
+        *error = HTTP_OUT_OF_BOUNDS;
+        return -1;
+    }
+    else if(status == -2) {
+        *error = HTTP_INVALID_HEADER;
+        return -1;
+    }
+
+    //The empty line means \r\n\r\n was found
+    if(c -> store_index == 0) {
+        return 2;
+    }
+
+    uint64_t key_len = c -> colon_index;
+    //value_start passes value_end if the value is only spaces and tabs
+    uint64_t val_len = c -> value_end > c -> value_start ? c -> value_end - c -> value_start : 0;
+
+    //no value?
+    if(val_len == 0) {
+        *error = HTTP_INVALID_HEADER;
+        return -1;
+    }
+
+    if(val_len > HTTP_MAX_HEADER_VAL_SIZE) {
+        *error = HTTP_OUT_OF_BOUNDS;
+        return -1;
+    }
+
+#ifdef HTTP_KNOWN_HEADERS
+    //Skipped headers count towards HTTP_MAX_HEADERS too, otherwise a request could send unlimited header lines
+    if(headers -> header_count + c -> skipped_headers == headers -> max_headers) {
+        *error = HTTP_OUT_OF_BOUNDS;
+        return -1;
+    }
+
+    if(known_only && !is_known_header(c -> store_buf, key_len)) {
+        c -> skipped_headers++;
+        return 1;
+    }
+#else
+    (void) known_only;
+#endif
+
+    headers_state ht = add_header_copy(headers, c -> store_buf, key_len, c -> store_buf + c -> value_start, val_len);
+    if(ht != HEADERS_OK_ERROR) {
         //If max header count was reached
-        else if(ht == HEADERS_OUT_OF_BOUNDS) {
-            free(key);
-            free(val);
-            req -> state = HTTP_ERROR;
-            req -> error = HTTP_OUT_OF_BOUNDS;
-            return;
+        *error = ht == HEADERS_OUT_OF_MEM ? HTTP_OUT_OF_MEM : HTTP_OUT_OF_BOUNDS;
+        return -1;
+    }
+
+    return 1;
+}
+
+/**
+ * Checks if a comma separated header value(such as Connection: keep-alive, Upgrade) contains token, ignoring case and spaces
+ */
+static bool has_list_token(const char *list, const char *token) {
+    uint64_t token_len = strlen(token);
+    uint64_t len;
+
+    for(const char *it = next_list_token(list, &len); it; it = next_list_token(it + len, &len)) {
+        if(len == token_len && strncasecmp(it, token, len) == 0) {
+            return true;
         }
     }
-    else {
-        //TODO FUTURE: Add Chunked transfer
-        char *content_len_str = get_header(req -> headers, "Content-Length", 0);
-        //Will not attempt to parse body unless Content-Length is found with a non zero value
-        if(content_len_str == 0 || strcmp(content_len_str, "0") == 0) {
-            req -> state = HTTP_FINISHED;
-            return;
+
+    return false;
+}
+
+/**
+ * The state a request ends in, HTTP_UPGRADED for CONNECT or an HTTP/1.1 Upgrade(which has to be listed in Connection)
+ */
+static http_response_state end_state(http_request_t *req) {
+    if(req -> method == HTTP_CONNECT) {
+        return HTTP_UPGRADED;
+    }
+
+    //Upgrade is ignored in HTTP/1.0
+    if(req -> version_major == 1 && req -> version_minor == 0) {
+        return HTTP_FINISHED;
+    }
+
+    if(!get_last_header(req -> headers, "Upgrade")) {
+        return HTTP_FINISHED;
+    }
+
+    for(uint64_t i = 0; i < num_header_vals(req -> headers, "Connection"); i++) {
+        if(has_list_token(get_header(req -> headers, "Connection", i), "upgrade")) {
+            return HTTP_UPGRADED;
         }
+    }
 
-        req -> state = HTTP_BODY_START;
+    return HTTP_FINISHED;
+}
+
+/**
+ * Attempts to find a single header and parse it. Stores the header in req -> headers
+ * @param req http_request_t
+ * @param buf buffer to parse
+ * @param buf_len length of buf
+ * @param it iterator for buf
+ */
+static void find_and_parse_header(http_request_t *req, const char *buf, uint64_t buf_len, uint64_t *it) {
+    int status = _parse_header_line(req -> _internal, req -> headers, true, buf, buf_len, it, &req -> error);
+
+    if(status == 0) {
+        return;
+    }
+    else if(status == -1) {
+        req -> state = HTTP_ERROR;
+        return;
     }
-    //the default next state is HTTP_HEADER_START as set by copy_delim
-    free(unparsed_header);
-    req -> _internal-> store_buf = 0;
+    //store_buf is reused for the next header
+    else if(status == 1) {
+        req -> state = HTTP_HEADER_START;
+        return;
+    }
+
+    _free_store_buf(req -> _internal);
+    req -> _internal -> store_buf = 0;
+
+    //TODO FUTURE: Add Chunked transfer
+    char *content_len_str = get_header(req -> headers, "Content-Length", 0);
+    //Will not attempt to parse body unless Content-Length is found with a non zero value
+    if(content_len_str == 0 || strcmp(content_len_str, "0") == 0) {
+        req -> state = end_state(req);
+        return;
+    }
+
+#ifdef HTTP_NO_BODY
+    //The body can't be skipped either, it would be parsed as the next request
+    req -> state = HTTP_ERROR;
+    req -> error = HTTP_INVALID_BODY;
+#else
+    req -> state = HTTP_BODY_START;
+#endif
 }
 
+#ifndef HTTP_NO_BODY
+
 /**
  * Allocates memory for body based on the Content-Length header
  * @param req http_request_t to store body
@@ -220,7 +548,10 @@ static void allocate_body(http_request_t *req) {
     // converting string to number
     for (uint64_t i = 0; content_len_str[i] != '\0'; i++) {
         if(content_len_str[i] >= 48 && content_len_str[i] <= 57) {
-            content_len = content_len * 10 + (content_len_str[i] - 48);
+            //Stops adding once the length is past both limits so very long lengths can't overflow, the rest is still checked for digits
+            if(content_len <= HTTP_MAX_BODY_SIZE || content_len <= HTTP_MAX_STREAMED_BODY_SIZE) {
+                content_len = content_len * 10 + (content_len_str[i] - 48);
+            }
         }
         else {
             req -> state = HTTP_ERROR;
@@ -229,37 +560,103 @@ static void allocate_body(http_request_t *req) {
         }  
     }
 
+    if(content_len <= 0) {
+        req -> state = end_state(req);
+        return;
+    }
+
+    req -> body_len = content_len;
+    req -> _internal -> store_index = 0;
+    req -> _internal -> search_index = 0;
+    req -> _internal -> store_buf_len = content_len;
+
+    int stage_status = req -> body_stage.begin ? req -> body_stage.begin(req -> body_stage.stage, req) : 0;
+
+    if(stage_status == -1) {
+        req -> state = HTTP_ERROR;
+        req -> error = HTTP_INVALID_BODY;
+        return;
+    }
+    //Streamed bodies are not stored so no memory is allocated
+    else if(stage_status == 1) {
+        if(content_len > HTTP_MAX_STREAMED_BODY_SIZE) {
+            req -> state = HTTP_ERROR;
+            req -> error = HTTP_OUT_OF_BOUNDS;
+            return;
+        }
+
+        req -> _internal -> body_streamed = true;
+        req -> state = HTTP_BODY;
+        return;
+    }
+
     if(content_len > HTTP_MAX_BODY_SIZE) {
         req -> state = HTTP_ERROR;
         req -> error = HTTP_OUT_OF_BOUNDS;
         return;
     }
 
-    if(content_len <= 0) {
-        req -> state = HTTP_FINISHED;
+    //Not zeroed since every byte is written by copy_body or the caller through http_body_dest
+    req -> _internal -> store_buf = malloc(content_len + 1);
+
+    if(!req -> _internal -> store_buf) {
+        req -> state = HTTP_ERROR;
+        req -> error = HTTP_OUT_OF_MEM;
         return;
     }
 
-    reset(req, content_len, HTTP_BODY);
+    req -> _internal -> store_buf[content_len] = '\0';
+    req -> state = HTTP_BODY;
 }
 
 /**
- * Copies body from buf based on how much memory was allocated by allocate_body
+ * Moves the body to req -> body and finishes the request once every byte has been stored
  */
-static void copy_body(http_request_t *req, const char *buf, uint64_t buf_len, uint64_t *it) {
-    while(*it < buf_len) {
-        req -> _internal -> store_buf[req -> _internal -> store_index++] = buf[*it];
-        //If body was fully copied
-        if(req -> _internal -> store_index == req -> _internal -> store_buf_len) {
+static void finish_body(http_request_t *req) {
+    if(req -> _internal -> store_index != req -> _internal -> store_buf_len) {
+        return;
+    }
 
-            req -> body = req -> _internal -> store_buf;
-            req -> state = HTTP_FINISHED;
+    if(req -> _internal -> body_streamed) {
+        if(req -> body_stage.finish && !req -> body_stage.finish(req -> body_stage.stage)) {
+            req -> state = HTTP_ERROR;
+            req -> error = HTTP_INVALID_BODY;
             return;
         }
+    }
+    else {
+        req -> body = (uint8_t*) req -> _internal -> store_buf;
+        req -> _internal -> store_buf = 0;
+    }
 
-        (*it)++;
+    //An upgrade only starts once the body is read
+    req -> state = end_state(req);
+}
+
+/**
+ * Copies as much of the body from buf as is available in one memcpy
+ */
+static void copy_body(http_request_t *req, const char *buf, uint64_t buf_len, uint64_t *it) {
+    uint64_t remaining = req -> _internal -> store_buf_len - req -> _internal -> store_index;
+    uint64_t available = buf_len - *it;
+    uint64_t len = remaining < available ? remaining : available;
+
+    if(req -> _internal -> body_streamed) {
+        if(!req -> body_stage.write(req -> body_stage.stage, buf + *it, len)) {
+            req -> state = HTTP_ERROR;
+            req -> error = HTTP_INVALID_BODY;
+            return;
+        }
     }
+    else {
+        memcpy(req -> _internal -> store_buf + req -> _internal -> store_index, buf + *it, len);
+    }
+    req -> _internal -> store_index += len;
+    *it += len;
+
+    finish_body(req);
 }
+#endif
 
 http_request_t* http_request_init() {
     http_request_t *temp = calloc(1, sizeof(http_request_t));
@@ -277,7 +674,7 @@ http_request_t* http_request_init() {
     temp -> _internal = calloc(1, sizeof(_copy_state));
 
     if(!temp -> _internal) {
-        free(temp -> headers);
+        headers_free(temp -> headers);
         free(temp);
         return NULL;
     }
@@ -287,15 +684,30 @@ http_request_t* http_request_init() {
     return temp;
 }
 
-void parse_http_request(http_request_t *req, const char* buf, uint64_t buf_len) {
+const char* http_method_str(http_method method) {
+    switch(method) {
+        case HTTP_GET: return "GET";
+        case HTTP_HEAD: return "HEAD";
+        case HTTP_POST: return "POST";
+        case HTTP_PUT: return "PUT";
+        case HTTP_DELETE: return "DELETE";
+        case HTTP_CONNECT: return "CONNECT";
+        case HTTP_OPTIONS: return "OPTIONS";
+        case HTTP_TRACE: return "TRACE";
+        case HTTP_PATCH: return "PATCH";
+        default: return 0;
+    }
+}
+
+uint64_t parse_http_request(http_request_t *req, const char* buf, uint64_t buf_len) {
     uint64_t i = 0;
     while(i < buf_len) {
         switch(req -> state) {
             case HTTP_METHOD_START:
-                reset(req, 8, HTTP_METHOD);
+                reset_token(req, HTTP_METHOD);
                 break;
             case HTTP_METHOD:
-                copy_to_delim(req, buf, buf_len, " ", 1, &(req -> method), &i, HTTP_PATH_START);
+                parse_method(req, buf, buf_len, &i);
                 break;
             case HTTP_PATH_START:
                 reset(req, HTTP_MAX_PATH_SIZE, HTTP_PATH);
@@ -304,53 +716,98 @@ void parse_http_request(http_request_t *req, const char* buf, uint64_t buf_len)
                 copy_to_delim(req, buf, buf_len, " ", 1, &(req -> path), &i, HTTP_VERSION_START);
                 break;
             case HTTP_VERSION_START:
-                reset(req, 8, HTTP_VERSION);
+                reset_token(req, HTTP_VERSION);
                 break;
             case HTTP_VERSION:
-                copy_to_delim(req, buf, buf_len, "\r\n", 2, &(req -> version), &i, HTTP_HEADER_START);
+                parse_version(req, buf, buf_len, &i);
                 break;
             case HTTP_HEADER_START:
-                reset(req, HTTP_MAX_HEADER_KEY_SIZE + 1 + HTTP_MAX_HEADER_VAL_SIZE, HTTP_HEADER_FIND_AND_PARSE);
+                reset_header(req);
                 break;
             case HTTP_HEADER_FIND_AND_PARSE:
                 find_and_parse_header(req, buf, buf_len, &i);
                 break;
+#ifndef HTTP_NO_BODY
             case HTTP_BODY_START:
                 allocate_body(req);
                 break;
             case HTTP_BODY:
                 copy_body(req, buf, buf_len, &i);
                 break;
+#endif
             default:
-                //in case of HTTP_ERROR or HTTP_FINISHED
-                return;
+                //in case of HTTP_ERROR, HTTP_FINISHED or HTTP_UPGRADED
+                return i;
         }
     }
+
+    return i;
+}
+
+void http_request_set_body_stage(http_request_t *req, http_body_stage_t stage) {
+    req -> body_stage = stage;
+}
+
+uint64_t http_body_dest(http_request_t *req, uint8_t **dest) {
+#ifdef HTTP_NO_BODY
+    (void) req;
+    *dest = 0;
+    return 0;
+#else
+    //The headers may have ended at the end of the last buf so the body wasn't allocated yet
+    if(req -> state == HTTP_BODY_START) {
+        allocate_body(req);
+    }
+
+    if(req -> state != HTTP_BODY || req -> _internal -> body_streamed) {
+        *dest = 0;
+        return 0;
+    }
+
+    *dest = (uint8_t*) req -> _internal -> store_buf + req -> _internal -> store_index;
+    return req -> _internal -> store_buf_len - req -> _internal -> store_index;
+#endif
+}
+
+void http_body_commit(http_request_t *req, uint64_t len) {
+#ifdef HTTP_NO_BODY
+    (void) req;
+    (void) len;
+#else
+    if(req -> state != HTTP_BODY || req -> _internal -> body_streamed) {
+        return;
+    }
+
+    uint64_t remaining = req -> _internal -> store_buf_len - req -> _internal -> store_index;
+    req -> _internal -> store_index += len < remaining ? len : remaining;
+
+    finish_body(req);
+#endif
 }
 
 void http_request_free(http_request_t* req) {
     if(req) {
-        if(req -> method) {
-            free(req -> method);
+#ifdef HTTP_FIXED_BUFFERS
+        //The path is inside _copy_state once it is parsed
+        if(req -> path && !(req -> _internal && req -> path == req -> _internal -> path)) {
+            free(req -> path);
         }
-
+#else
         if(req -> path) {
             free(req -> path);
         }
+#endif
 
-        if(req -> version) {
-            free(req -> version);
+        if(req -> body) {
+            free(req -> body);
         }
 
         if(req -> headers) {
             headers_free(req -> headers);
         }
 
-        if(req -> _internal -> store_buf) {
-            free(req -> _internal -> store_buf);
-        }
-
         if(req -> _internal) {
+            _free_store_buf(req -> _internal);
             free(req -> _internal);
         }
 
@@ -1,8 +1,23 @@
 #include <catch2/catch_test_macros.hpp>
+#include <string>
 
 extern "C" {
     #include <string.h>
     #include "simple_http.h"
+    #include "http_writer.h"
+    #include "multipart.h"
+#ifdef SIMPLE_HTTP_ZLIB
+    #include "http_inflate.h"
+#endif
+}
+
+//Joins the iovecs built by http_writer_t into a C string
+static std::string join_iov(http_writer_t *writer) {
+    std::string out;
+    for(uint64_t i = 0; i < writer -> iov_count; i++) {
+        out.append((char*)writer -> iov[i].iov_base, writer -> iov[i].iov_len);
+    }
+    return out;
 }
 
 TEST_CASE("MINIMAL REQUEST") {
@@ -12,9 +27,10 @@ TEST_CASE("MINIMAL REQUEST") {
    parse_http_request(req, req_str, strlen(req_str));
 
    REQUIRE(req -> state == HTTP_FINISHED);
-   REQUIRE(strcmp(req -> method, "GET") == 0);
+   REQUIRE(req -> method == HTTP_GET);
    REQUIRE(strcmp(req -> path, "/test_path/1") == 0);
-   REQUIRE(strcmp(req -> version, "HTTP/1.1") == 0);
+   REQUIRE(req -> version_major == 1);
+   REQUIRE(req -> version_minor == 1);
 
    http_request_free(req);
 }
@@ -27,9 +43,10 @@ TEST_CASE("HEADERS AND BODY") {
    parse_http_request(req, req_str, strlen(req_str));
 
    REQUIRE(req -> state == HTTP_FINISHED);
-   REQUIRE(strcmp(req -> method, "POST") == 0);
+   REQUIRE(req -> method == HTTP_POST);
    REQUIRE(strcmp(req -> path, "/test_path/1") == 0);
-   REQUIRE(strcmp(req -> version, "HTTP/1.1") == 0);
+   REQUIRE(req -> version_major == 1);
+   REQUIRE(req -> version_minor == 1);
 
    char *accept = get_last_header(req -> headers, "Accept");
    REQUIRE(strcmp(accept, "text/html, application/xhtml+xml, application/xml;q=0.9, image/webp, ;q=0.8") == 0);
@@ -62,9 +79,10 @@ TEST_CASE("PARSING CHUNCKS") {
    parse_http_request(req, "st--", 4);
 
    REQUIRE(req -> state == HTTP_FINISHED);
-   REQUIRE(strcmp(req -> method, "POST") == 0);
+   REQUIRE(req -> method == HTTP_POST);
    REQUIRE(strcmp(req -> path, "/test_path/1") == 0);
-   REQUIRE(strcmp(req -> version, "HTTP/1.1") == 0);
+   REQUIRE(req -> version_major == 1);
+   REQUIRE(req -> version_minor == 1);
 
    char *accept = get_last_header(req -> headers, "Accept");
    REQUIRE(strcmp(accept, "text/html, application/xhtml+xml, application/xml;q=0.9, image/webp, ;q=0.8") == 0);
@@ -198,6 +216,19 @@ TEST_CASE("INVALID HEADER -> MISSING KEY") {
     http_request_free(req);
 }
 
+TEST_CASE("INVALID HEADER -> ONLY SPACES VAL") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "PUT /test1 HTTP/1.1\r\nKEY: \t \r\n\r\n";
+
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_HEADER);
+
+    http_request_free(req);
+}
+
 TEST_CASE("INVALID HEADER -> MISSING VAL") {
     http_request_t *req = http_request_init();
 
@@ -223,4 +254,513 @@ TEST_CASE("OUT OF BOUNDS -> BODY") {
     REQUIRE(req -> error == HTTP_OUT_OF_BOUNDS);
 
     http_request_free(req);
-}
\ No newline at end of file
+}
+
+//Digits past the limit are still checked so a long invalid length isn't reported as out of bounds
+TEST_CASE("INVALID HEADER -> LONG CONTENT LENGTH") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "PUT /test1 HTTP/1.1\r\nContent-Length: 99999999999x\r\n\r\ntest";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_HEADER);
+    http_request_free(req);
+
+    req = http_request_init();
+    req_str = "PUT /test1 HTTP/1.1\r\nContent-Length: 99999999999999999999999999\r\n\r\ntest";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_OUT_OF_BOUNDS);
+    http_request_free(req);
+}
+
+//Header keys are stored lowercase and can be looked up with any casing
+TEST_CASE("HEADER KEYS -> CASE INSENSITIVE") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "POST /test1 HTTP/1.1\r\nX-Custom-Key: val\r\ncontent-length: 4\r\n\r\ntest";
+
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(strcmp(get_last_header(req -> headers, "x-custom-key"), "val") == 0);
+    REQUIRE(strcmp(get_last_header(req -> headers, "X-CUSTOM-KEY"), "val") == 0);
+    REQUIRE(strcmp((char*)req -> body, "test") == 0);
+
+    http_request_free(req);
+}
+
+//Header keys can only contain RFC 7230 token characters(no spaces, separators or control characters)
+TEST_CASE("INVALID HEADER -> INVALID KEY CHARACTER") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "PUT /test1 HTTP/1.1\r\nBAD KEY: VAL\r\n\r\n";
+
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_HEADER);
+
+    http_request_free(req);
+}
+
+
+//Only the methods in http_method are accepted
+TEST_CASE("INVALID METHOD") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "GTE /test HTTP/1.1\r\n\r\n";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_METHOD);
+
+    http_request_free(req);
+}
+
+//The version has to be formatted as HTTP/<digit>.<digit>
+TEST_CASE("INVALID VERSION") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "GET /test HTTP/1-1\r\n\r\n";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_VERSION);
+
+    http_request_free(req);
+}
+
+//Shows how a parsed request can be forwarded with writev(fd, writer -> iov, writer -> iov_count)
+TEST_CASE("WRITER -> FORWARD REQUEST") {
+    http_request_t *req = http_request_init();
+    http_writer_t *writer = http_writer_init();
+
+    //X-Hop is hop-by-hop since it is listed in Connection
+    char *req_str = "POST /test HTTP/1.1\r\nHost: example.com\r\nConnection: keep-alive, X-Hop\r\nX-Hop: 1\r\nContent-Length: 4\r\n\r\ntest";
+    parse_http_request(req, req_str, strlen(req_str));
+    REQUIRE(req -> state == HTTP_FINISHED);
+
+    REQUIRE(http_writer_remove_hop_by_hop(writer, req -> headers) == HTTP_WRITER_OK);
+    REQUIRE(http_writer_add_header(writer, "X-Forwarded-For", "10.0.0.1") == HTTP_WRITER_OK);
+    REQUIRE(http_writer_request(writer, req) == HTTP_WRITER_OK);
+
+    //Header keys are written lowercase as they are stored
+    REQUIRE(join_iov(writer) == "POST /test HTTP/1.1\r\nhost: example.com\r\ncontent-length: 4\r\nX-Forwarded-For: 10.0.0.1\r\n\r\ntest");
+
+    //Simulates a partial writev of 16 bytes
+    http_writer_advance(writer, 16);
+    REQUIRE(join_iov(writer) == "1.1\r\nhost: example.com\r\ncontent-length: 4\r\nX-Forwarded-For: 10.0.0.1\r\n\r\ntest");
+
+    http_writer_free(writer);
+    http_request_free(req);
+}
+
+TEST_CASE("WRITER -> RESPONSE") {
+    http_writer_t *writer = http_writer_init();
+    headers_t *headers = headers_init(4);
+
+    add_header(headers, strdup("Content-Length"), strdup("2"));
+
+    REQUIRE(http_writer_response(writer, 200, "OK", headers, (uint8_t*)"ok", 2) == HTTP_WRITER_OK);
+    REQUIRE(join_iov(writer) == "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok");
+
+    REQUIRE(http_writer_response(writer, 20, "OK", headers, 0, 0) == HTTP_WRITER_INVALID);
+
+    headers_free(headers);
+    http_writer_free(writer);
+}
+
+//A headers_t bigger than HTTP_MAX_HEADERS can't fit in the iovecs
+TEST_CASE("WRITER -> TOO MANY HEADERS") {
+    http_writer_t *writer = http_writer_init();
+    headers_t *headers = headers_init(HTTP_MAX_HEADERS * 2);
+
+    for(int i = 0; i < HTTP_MAX_HEADERS * 2; i++) {
+        add_header(headers, strdup(("X-" + std::to_string(i)).c_str()), strdup("a"));
+    }
+
+    REQUIRE(http_writer_response(writer, 200, "OK", headers, 0, 0) == HTTP_WRITER_OUT_OF_BOUNDS);
+    REQUIRE(writer -> iov_count == 0);
+
+    headers_free(headers);
+    http_writer_free(writer);
+}
+
+//http_request_free can be called after any chunk, even when the last field was just finished
+TEST_CASE("FREE MID PARSE") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "GET /test ";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_VERSION_START);
+    REQUIRE(strcmp(req -> path, "/test") == 0);
+
+    http_request_free(req);
+}
+
+//A bare \r could be forwarded as a line break(header injection) and a NUL would cut the value short
+TEST_CASE("HEADER VALUE -> CONTROL CHARACTERS") {
+    std::string invalid[] = {
+        std::string("GET /test HTTP/1.1\r\nX: a\rInjected: b\r\n\r\n"),
+        std::string("GET /test HTTP/1.1\r\nY: c\0d\r\n\r\n", 30),
+        std::string("GET /test HTTP/1.1\r\nZ: e\x7f\r\n\r\n"),
+    };
+
+    for(std::string &req_str : invalid) {
+        http_request_t *req = http_request_init();
+        parse_http_request(req, req_str.data(), req_str.size());
+
+        REQUIRE(req -> state == HTTP_ERROR);
+        REQUIRE(req -> error == HTTP_INVALID_HEADER);
+        http_request_free(req);
+    }
+
+    //Tabs are still allowed inside the value
+    http_request_t *req = http_request_init();
+    char *tab = "GET /test HTTP/1.1\r\nX: a\tb\r\n\r\n";
+    parse_http_request(req, tab, strlen(tab));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(strcmp(get_last_header(req -> headers, "X"), "a\tb") == 0);
+    http_request_free(req);
+}
+
+//Spaces and tabs around the value are not stored
+TEST_CASE("HEADER VALUE -> TRIMMED") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "GET /test HTTP/1.1\r\nHost: \t example.com \t \r\n\r\n";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(strcmp(get_last_header(req -> headers, "Host"), "example.com") == 0);
+
+    http_request_free(req);
+}
+
+//A line starting with a space or tab continues the previous value(obs-fold), the fold is replaced by spaces
+TEST_CASE("HEADER VALUE -> OBS FOLD") {
+    http_request_t *req = http_request_init();
+
+    char *first = "GET /test HTTP/1.1\r\nX-Long: first\r\n";
+    char *second = "\tsecond\r\nHost: a\r\n\r\n";
+
+    parse_http_request(req, first, strlen(first));
+    //The header can't be stored until the start of the next line is known
+    REQUIRE(req -> headers -> header_count == 0);
+    parse_http_request(req, second, strlen(second));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(strcmp(get_last_header(req -> headers, "X-Long"), "first second") == 0);
+    REQUIRE(strcmp(get_last_header(req -> headers, "Host"), "a") == 0);
+
+    http_request_free(req);
+}
+
+//Once the headers are parsed the body can be received straight into req -> body
+TEST_CASE("BODY -> DIRECT RECEIVE") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "POST /test HTTP/1.1\r\nContent-Length: 10\r\n\r\n0123";
+    parse_http_request(req, req_str, strlen(req_str));
+    REQUIRE(req -> state == HTTP_BODY);
+
+    uint8_t *dest;
+    uint64_t remaining = http_body_dest(req, &dest);
+    REQUIRE(remaining == 6);
+
+    //Simulates recv writing part of the body
+    memcpy(dest, "456", 3);
+    http_body_commit(req, 3);
+    REQUIRE(req -> state == HTTP_BODY);
+
+    remaining = http_body_dest(req, &dest);
+    REQUIRE(remaining == 3);
+    memcpy(dest, "789", 3);
+    http_body_commit(req, 3);
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(req -> body_len == 10);
+    REQUIRE(strcmp((char*)req -> body, "0123456789") == 0);
+    REQUIRE(http_body_dest(req, &dest) == 0);
+
+    http_request_free(req);
+}
+
+//Collects every part as "name=data;" using the parts Content-Disposition header
+static bool collect_part_begin(headers_t *headers, void *user) {
+    std::string *out = (std::string*) user;
+    out -> append(get_last_header(headers, "Content-Disposition"));
+    out -> append("=");
+    return true;
+}
+
+static bool collect_part_data(const char *data, uint64_t len, void *user) {
+    ((std::string*) user) -> append(data, len);
+    return true;
+}
+
+static bool collect_part_end(void *user) {
+    ((std::string*) user) -> append(";");
+    return true;
+}
+
+//Multipart bodies are streamed through the callbacks instead of being stored in req -> body
+TEST_CASE("MULTIPART -> PARTS") {
+    std::string body = "preamble\r\n--XyZ\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\nfirst\r\n--X\r\n-"
+                       "\r\n--XyZ\r\ncontent-disposition: file\r\nContent-Type: text/plain\r\n\r\n\r\n--Xy\r\n--XyZ--\r\nepilogue";
+    std::string req_str = "POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=\"XyZ\"\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    //Every chunk size has to give the same result
+    for(uint64_t chunk = 1; chunk <= 64; chunk++) {
+        std::string out;
+        multipart_callbacks_t callbacks = {collect_part_begin, collect_part_data, collect_part_end, &out};
+        multipart_t *mp = multipart_init(callbacks);
+        http_request_t *req = http_request_init();
+        http_request_set_body_stage(req, multipart_body_stage(mp));
+
+        for(uint64_t i = 0; i < req_str.size(); i += chunk) {
+            parse_http_request(req, req_str.c_str() + i, req_str.size() - i < chunk ? req_str.size() - i : chunk);
+        }
+
+        REQUIRE(req -> state == HTTP_FINISHED);
+        REQUIRE(req -> body == 0);
+        REQUIRE(out == "form-data; name=\"a\"=first\r\n--X\r\n-;file=\r\n--Xy;");
+
+        http_request_free(req);
+        multipart_free(mp);
+    }
+}
+
+TEST_CASE("MULTIPART -> MISSING LAST BOUNDARY") {
+    std::string out;
+    multipart_callbacks_t callbacks = {collect_part_begin, collect_part_data, collect_part_end, &out};
+    multipart_t *mp = multipart_init(callbacks);
+    http_request_t *req = http_request_init();
+    http_request_set_body_stage(req, multipart_body_stage(mp));
+
+    char *req_str = "POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=b\r\nContent-Length: 38\r\n\r\n--b\r\nContent-Disposition: x\r\n\r\ndata123";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_BODY);
+    REQUIRE(mp -> error == HTTP_INVALID_BODY);
+
+    http_request_free(req);
+    multipart_free(mp);
+}
+
+//A streamed body isn't stored so the request can't be forwarded with its Content-Length
+TEST_CASE("WRITER -> STREAMED BODY") {
+    std::string out;
+    multipart_callbacks_t callbacks = {collect_part_begin, collect_part_data, collect_part_end, &out};
+    multipart_t *mp = multipart_init(callbacks);
+    http_request_t *req = http_request_init();
+    http_writer_t *writer = http_writer_init();
+    http_request_set_body_stage(req, multipart_body_stage(mp));
+
+    char *req_str = "POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=b\r\nContent-Length: 38\r\n\r\n--b\r\nContent-Disposition: x\r\n\r\n\r\n--b--";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(http_writer_request(writer, req) == HTTP_WRITER_INVALID);
+
+    http_writer_free(writer);
+    http_request_free(req);
+    multipart_free(mp);
+}
+
+//A half parsed request can be saved, freed and restored(such as on another thread) and keep parsing
+TEST_CASE("SNAPSHOT -> SAVE AND RESTORE") {
+    http_request_t *req = http_request_init();
+
+    char *first = "POST /test HTTP/1.1\r\nHost: example.com\r\nContent-Le";
+    char *second = "ngth: 4\r\n\r\nte";
+    char *third = "st";
+
+    parse_http_request(req, first, strlen(first));
+
+    uint64_t size = http_request_save(req, 0, 0);
+    std::string snapshot(size, '\0');
+    REQUIRE(http_request_save(req, (uint8_t*) &snapshot[0], size) == size);
+    http_request_free(req);
+
+    req = http_request_restore((uint8_t*) snapshot.data(), size);
+    REQUIRE(req != 0);
+    parse_http_request(req, second, strlen(second));
+
+    //Saved again in the middle of the body
+    size = http_request_save(req, 0, 0);
+    snapshot.assign(size, '\0');
+    http_request_save(req, (uint8_t*) &snapshot[0], size);
+    http_request_free(req);
+
+    req = http_request_restore((uint8_t*) snapshot.data(), size);
+    REQUIRE(req != 0);
+    parse_http_request(req, third, strlen(third));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(req -> method == HTTP_POST);
+    REQUIRE(strcmp(req -> path, "/test") == 0);
+    REQUIRE(strcmp(get_last_header(req -> headers, "Host"), "example.com") == 0);
+    REQUIRE(strcmp((char*)req -> body, "test") == 0);
+
+    //Cut off snapshots are rejected
+    REQUIRE(http_request_restore((uint8_t*) snapshot.data(), size - 1) == 0);
+
+    //A body state without its Content-Length header is rejected, the state is the second byte
+    http_request_t *empty = http_request_init();
+    size = http_request_save(empty, 0, 0);
+    snapshot.assign(size, '\0');
+    http_request_save(empty, (uint8_t*) &snapshot[0], size);
+    snapshot[1] = HTTP_BODY_START;
+    REQUIRE(http_request_restore((uint8_t*) snapshot.data(), size) == 0);
+
+    //So is an error past HTTP_INVALID_BODY
+    snapshot[1] = HTTP_ERROR;
+    snapshot[2] = HTTP_INVALID_BODY + 1;
+    REQUIRE(http_request_restore((uint8_t*) snapshot.data(), size) == 0);
+    http_request_free(empty);
+
+    http_request_free(req);
+}
+
+//Parsing stops at the end of the headers and the offset of the WebSocket data is returned
+TEST_CASE("UPGRADE -> WEBSOCKET HAND-OFF") {
+    http_request_t *req = http_request_init();
+
+    std::string head = "GET /chat HTTP/1.1\r\nHost: example.com\r\nUpgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n\r\n";
+    std::string frame = "\x81\x05hello";
+    std::string first = head.substr(0, 30);
+    std::string second = head.substr(30) + frame;
+
+    REQUIRE(parse_http_request(req, first.data(), first.size()) == first.size());
+    uint64_t parsed = parse_http_request(req, second.data(), second.size());
+
+    REQUIRE(req -> state == HTTP_UPGRADED);
+    REQUIRE(parsed == head.size() - 30);
+    REQUIRE(second.substr(parsed) == frame);
+    REQUIRE(strcmp(get_last_header(req -> headers, "Upgrade"), "websocket") == 0);
+
+    //Parsing after the upgrade does nothing
+    REQUIRE(parse_http_request(req, frame.data(), frame.size()) == 0);
+
+    http_request_free(req);
+}
+
+TEST_CASE("UPGRADE -> CONNECT AND IGNORED UPGRADES") {
+    http_request_t *req = http_request_init();
+    char *connect = "CONNECT example.com:443 HTTP/1.1\r\nHost: example.com:443\r\n\r\n\x16\x03\x01";
+
+    uint64_t parsed = parse_http_request(req, connect, strlen(connect));
+    REQUIRE(req -> state == HTTP_UPGRADED);
+    REQUIRE(req -> method == HTTP_CONNECT);
+    REQUIRE(strcmp(connect + parsed, "\x16\x03\x01") == 0);
+    http_request_free(req);
+
+    //Upgrade has to be listed in Connection
+    req = http_request_init();
+    char *no_connection = "GET /chat HTTP/1.1\r\nUpgrade: websocket\r\nConnection: upgrades\r\n\r\n";
+    parse_http_request(req, no_connection, strlen(no_connection));
+    REQUIRE(req -> state == HTTP_FINISHED);
+    http_request_free(req);
+
+    //Upgrade is ignored in HTTP/1.0
+    req = http_request_init();
+    char *old_version = "GET /chat HTTP/1.0\r\nUpgrade: websocket\r\nConnection: upgrade\r\n\r\n";
+    parse_http_request(req, old_version, strlen(old_version));
+    REQUIRE(req -> state == HTTP_FINISHED);
+    http_request_free(req);
+}
+
+//The returned offset is where the next pipelined request starts
+TEST_CASE("PIPELINE -> PARSE FROM RETURNED OFFSET") {
+    char *reqs = "POST /a HTTP/1.1\r\nContent-Length: 2\r\n\r\nhiGET /b HTTP/1.1\r\n\r\n";
+    uint64_t len = strlen(reqs);
+
+    http_request_t *first = http_request_init();
+    uint64_t parsed = parse_http_request(first, reqs, len);
+    REQUIRE(first -> state == HTTP_FINISHED);
+    REQUIRE(strcmp((char*)first -> body, "hi") == 0);
+
+    http_request_t *second = http_request_init();
+    REQUIRE(parse_http_request(second, reqs + parsed, len - parsed) == len - parsed);
+    REQUIRE(second -> state == HTTP_FINISHED);
+    REQUIRE(strcmp(second -> path, "/b") == 0);
+
+    http_request_free(first);
+    http_request_free(second);
+}
+
+#ifdef SIMPLE_HTTP_ZLIB
+//Compresses data with a gzip header
+static std::string gzip(const std::string &data) {
+    z_stream stream = {};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+    std::string out(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = (Bytef*) data.data();
+    stream.avail_in = data.size();
+    stream.next_out = (Bytef*) &out[0];
+    stream.avail_out = out.size();
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    return out;
+}
+
+static bool collect_inflated(const uint8_t *data, uint64_t len, void *user) {
+    ((std::string*) user) -> append((const char*) data, len);
+    return true;
+}
+
+//gzip bodies are inflated as they arrive instead of being stored in req -> body
+TEST_CASE("INFLATE -> GZIP BODY") {
+    std::string plain(10000, 'a');
+    std::string body = gzip(plain);
+    std::string req_str = "POST /test HTTP/1.1\r\nContent-Encoding: gzip\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    std::string out;
+    http_inflate_t *inf = http_inflate_init(20000, collect_inflated, &out);
+    http_request_t *req = http_request_init();
+    http_request_set_body_stage(req, http_inflate_body_stage(inf));
+
+    for(uint64_t i = 0; i < req_str.size(); i += 7) {
+        parse_http_request(req, req_str.c_str() + i, req_str.size() - i < 7 ? req_str.size() - i : 7);
+    }
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(out == plain);
+    REQUIRE(inf -> total_out == plain.size());
+
+    http_request_free(req);
+    http_inflate_free(inf);
+}
+
+//The decompressed size limit stops zip bombs
+TEST_CASE("INFLATE -> OUT OF BOUNDS") {
+    std::string body = gzip(std::string(100000, 'a'));
+    std::string req_str = "POST /test HTTP/1.1\r\nContent-Encoding: gzip\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    uint8_t dest[1000];
+    http_inflate_t *inf = http_inflate_init(50000, 0, 0);
+    http_inflate_set_dest(inf, dest, sizeof(dest));
+    http_request_t *req = http_request_init();
+    http_request_set_body_stage(req, http_inflate_body_stage(inf));
+
+    parse_http_request(req, req_str.c_str(), req_str.size());
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_BODY);
+    REQUIRE(inf -> error == HTTP_OUT_OF_BOUNDS);
+    REQUIRE(inf -> total_out == sizeof(dest));
+
+    http_request_free(req);
+    http_inflate_free(inf);
+}
+#endif
@@ -0,0 +1,13 @@
+#include <string.h>
+#include "simple_http.h"
+
+//Built against SIMPLE_HTTP and linked into HTTP_PROFILE_TESTS next to the health check profile
+uint64_t default_parser_header_count(const char *req_str) {
+    http_request_t *req = http_request_init();
+    parse_http_request(req, req_str, strlen(req_str));
+
+    uint64_t header_count = req -> state == HTTP_FINISHED ? req -> headers -> header_count : 0;
+    http_request_free(req);
+
+    return header_count;
+}
@@ -0,0 +1,146 @@
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+//Built against profiles/health_check.h(see tests/CMakeLists.txt)
+extern "C" {
+    #include <string.h>
+    #include "simple_http.h"
+}
+
+TEST_CASE("PROFILE -> KNOWN HEADERS ONLY") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "GET /health HTTP/1.1\r\nHost: example.com\r\nX-Request-Id: 1234\r\nConnection: close\r\n\r\n";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(req -> method == HTTP_GET);
+    REQUIRE(strcmp(req -> path, "/health") == 0);
+    REQUIRE(req -> headers -> header_count == 2);
+    REQUIRE(strcmp(get_last_header(req -> headers, "Host"), "example.com") == 0);
+    REQUIRE(strcmp(get_last_header(req -> headers, "Connection"), "close") == 0);
+    REQUIRE(get_last_header(req -> headers, "X-Request-Id") == 0);
+
+    http_request_free(req);
+}
+
+TEST_CASE("PROFILE -> METHODS AND BODIES REJECTED") {
+    http_request_t *req = http_request_init();
+
+    char *post = "POST /health HTTP/1.1\r\n\r\n";
+    parse_http_request(req, post, strlen(post));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_METHOD);
+    http_request_free(req);
+
+    //Content-Length is always stored so the body isn't read as the next request
+    req = http_request_init();
+    char *body = "GET /health HTTP/1.1\r\nContent-Length: 4\r\n\r\ntest";
+    parse_http_request(req, body, strlen(body));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_INVALID_BODY);
+    http_request_free(req);
+}
+
+//The path and header line are inline so a snapshot has to be restored into them
+TEST_CASE("PROFILE -> FIXED BUFFER SNAPSHOT") {
+    http_request_t *req = http_request_init();
+
+    char *first = "HEAD /metr";
+    char *second = "ics HTTP/1.1\r\nHost: exa";
+    char *third = "mple.com\r\n\r\n";
+
+    parse_http_request(req, first, strlen(first));
+
+    for(char *next : {second, third}) {
+        std::string snapshot(http_request_save(req, 0, 0), '\0');
+        http_request_save(req, (uint8_t*) &snapshot[0], snapshot.size());
+        http_request_free(req);
+
+        req = http_request_restore((uint8_t*) snapshot.data(), snapshot.size());
+        REQUIRE(req != 0);
+        parse_http_request(req, next, strlen(next));
+    }
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(req -> method == HTTP_HEAD);
+    REQUIRE(strcmp(req -> path, "/metrics") == 0);
+    REQUIRE(strcmp(get_last_header(req -> headers, "Host"), "example.com") == 0);
+
+    http_request_free(req);
+}
+
+//Headers that aren't stored still count towards HTTP_MAX_HEADERS(16) so the header lines are bounded
+TEST_CASE("PROFILE -> SKIPPED HEADERS LIMITED") {
+    std::string req_str = "GET /health HTTP/1.1\r\nHost: example.com\r\n";
+    for(int i = 0; i < 15; i++) {
+        req_str += "X-Padding: " + std::to_string(i) + "\r\n";
+    }
+
+    http_request_t *req = http_request_init();
+    std::string ok = req_str + "\r\n";
+    parse_http_request(req, ok.data(), ok.size());
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(req -> headers -> header_count == 1);
+    http_request_free(req);
+
+    //The 17th line fails, the count is kept in a snapshot
+    req = http_request_init();
+    parse_http_request(req, req_str.data(), req_str.size());
+
+    std::string snapshot(http_request_save(req, 0, 0), '\0');
+    http_request_save(req, (uint8_t*) &snapshot[0], snapshot.size());
+    http_request_free(req);
+
+    req = http_request_restore((uint8_t*) snapshot.data(), snapshot.size());
+    REQUIRE(req != 0);
+
+    char *extra = "X-Padding: 15\r\n\r\n";
+    parse_http_request(req, extra, strlen(extra));
+
+    REQUIRE(req -> state == HTTP_ERROR);
+    REQUIRE(req -> error == HTTP_OUT_OF_BOUNDS);
+    http_request_free(req);
+}
+
+extern "C" uint64_t default_parser_header_count(const char *req_str);
+
+//SIMPLE_HTTP is linked into the same program(see tests/CMakeLists.txt), the prefix keeps the two parsers apart
+TEST_CASE("PROFILE -> LINKED WITH DEFAULT PARSER") {
+    char *req_str = "GET /health HTTP/1.1\r\nHost: example.com\r\nX-Request-Id: 1234\r\n\r\n";
+
+    http_request_t *req = http_request_init();
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(req -> headers -> header_count == 1);
+    REQUIRE(default_parser_header_count(req_str) == 2);
+
+    http_request_free(req);
+}
+
+//HTTP_FIXED_BUFFERS copies headers into slots allocated with headers_t
+TEST_CASE("PROFILE -> FIXED HEADER TABLE") {
+    http_request_t *req = http_request_init();
+
+    char *req_str = "GET /health HTTP/1.1\r\nAccept: text/plain\r\nHost: example.com\r\naccept: application/json\r\n\r\n";
+    parse_http_request(req, req_str, strlen(req_str));
+
+    REQUIRE(req -> state == HTTP_FINISHED);
+    REQUIRE(num_header_vals(req -> headers, "ACCEPT") == 2);
+    REQUIRE(strcmp(get_header(req -> headers, "Accept", 0), "text/plain") == 0);
+    REQUIRE(strcmp(get_header(req -> headers, "Accept", 1), "application/json") == 0);
+    REQUIRE(get_header(req -> headers, "Accept", 2) == 0);
+    REQUIRE(strcmp(get_last_header(req -> headers, "accept"), "application/json") == 0);
+    REQUIRE(strcmp(req -> headers -> entries[1].key, "host") == 0);
+
+    //Keys and values longer than a slot can't be added
+    std::string long_val(HTTP_MAX_HEADER_VAL_SIZE + 1, 'a');
+    REQUIRE(add_header_copy(req -> headers, "accept", 6, long_val.data(), long_val.size()) == HEADERS_OUT_OF_BOUNDS);
+    REQUIRE(req -> headers -> header_count == 3);
+
+    http_request_free(req);
+}
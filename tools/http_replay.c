@@ -0,0 +1,278 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "simple_http.h"
+
+/**
+ * Replays a capture file of raw requests through parse_http_request to measure throughput.
+ * The capture is memory mapped and every request is parsed straight from the mapping(nothing is copied).
+ *
+ * Capture format: records of a 4 byte big endian length followed by that many bytes of raw requests. A record can hold
+ * several pipelined requests, each starts where parse_http_request says the last one ended. Anything after a CONNECT or
+ * Upgrade request is tunnel data and is not parsed.
+ */
+
+#define ERROR_COUNT (HTTP_INVALID_BODY + 1)
+
+static const char *error_names[ERROR_COUNT] = {
+    "HTTP_OK", "HTTP_OUT_OF_MEM", "HTTP_OUT_OF_BOUNDS", "HTTP_INVALID_HEADER", "HTTP_INVALID_METHOD", "HTTP_INVALID_VERSION",
+    "HTTP_INVALID_BODY"
+};
+
+typedef struct {
+    const char *buf;
+    uint64_t len;
+} record_t;
+
+typedef struct {
+    //Shared input
+    record_t *records;
+    uint64_t record_count;
+    uint64_t iterations;
+    uint64_t chunk_size;
+    uint64_t thread_index;
+    uint64_t thread_count;
+    //Results for this thread
+    uint64_t finished;
+    uint64_t upgraded;
+    uint64_t incomplete;
+    uint64_t errors[ERROR_COUNT];
+    uint64_t bytes;
+} worker_t;
+
+/**
+ * Finds every record in the mapping
+ * @returns number of records or -1 if a record is cut off
+ */
+static int64_t index_records(const uint8_t *map, uint64_t map_len, record_t **records) {
+    uint64_t cap = 1024;
+    uint64_t count = 0;
+    *records = malloc(cap * sizeof(record_t));
+
+    uint64_t i = 0;
+    while(*records && i < map_len) {
+        if(map_len - i < 4) {
+            return -1;
+        }
+
+        uint64_t len = ((uint64_t) map[i] << 24) | ((uint64_t) map[i + 1] << 16) | ((uint64_t) map[i + 2] << 8) | map[i + 3];
+        i += 4;
+
+        if(len > map_len - i) {
+            return -1;
+        }
+
+        if(count == cap) {
+            cap *= 2;
+            record_t *temp = realloc(*records, cap * sizeof(record_t));
+            if(!temp) {
+                return -1;
+            }
+            *records = temp;
+        }
+
+        (*records)[count].buf = (const char*) map + i;
+        (*records)[count].len = len;
+        count++;
+        i += len;
+    }
+
+    return *records ? (int64_t) count : -1;
+}
+
+/**
+ * Adds the state req ended in to the worker's results
+ */
+static void count_request(worker_t *w, http_request_t *req) {
+    if(req -> state == HTTP_FINISHED) {
+        w -> finished++;
+    }
+    else if(req -> state == HTTP_UPGRADED) {
+        w -> upgraded++;
+    }
+    else if(req -> state == HTTP_ERROR) {
+        w -> errors[req -> error]++;
+    }
+    else {
+        w -> incomplete++;
+    }
+}
+
+/**
+ * Parses every thread_count'th record starting at thread_index, split into chunk_size pieces
+ */
+static void* run_worker(void *arg) {
+    worker_t *w = arg;
+
+    for(uint64_t n = 0; n < w -> iterations; n++) {
+        for(uint64_t r = w -> thread_index; r < w -> record_count; r += w -> thread_count) {
+            http_request_t *req = http_request_init();
+            if(!req) {
+                w -> errors[HTTP_OUT_OF_MEM]++;
+                continue;
+            }
+
+            const char *buf = w -> records[r].buf;
+            uint64_t len = w -> records[r].len;
+
+            uint64_t i = 0;
+            while(i < len) {
+                uint64_t chunk_len = len - i < w -> chunk_size ? len - i : w -> chunk_size;
+                uint64_t parsed = parse_http_request(req, buf + i, chunk_len);
+
+                //The next pipelined request starts in the same chunk, right where this one finished
+                if(req -> state == HTTP_FINISHED && i + parsed < len) {
+                    count_request(w, req);
+                    http_request_free(req);
+
+                    req = http_request_init();
+                    if(!req) {
+                        w -> errors[HTTP_OUT_OF_MEM]++;
+                        break;
+                    }
+
+                    i += parsed;
+                }
+                //Nothing after an error can be parsed and everything after an upgrade is tunnel data
+                else if(req -> state == HTTP_ERROR || req -> state == HTTP_UPGRADED) {
+                    break;
+                }
+                else {
+                    i += chunk_len;
+                }
+            }
+
+            if(req) {
+                count_request(w, req);
+                http_request_free(req);
+            }
+
+            w -> bytes += len;
+        }
+    }
+
+    return 0;
+}
+
+static void usage() {
+    fprintf(stderr, "Usage: HTTP_REPLAY [-t threads] [-n iterations] [-c chunk_size] capture_file\n");
+}
+
+int main(int argc, char **argv) {
+    uint64_t thread_count = 1;
+    uint64_t iterations = 1;
+    uint64_t chunk_size = UINT64_MAX;
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:n:c:")) != -1) {
+        switch(opt) {
+            case 't': thread_count = strtoull(optarg, 0, 10); break;
+            case 'n': iterations = strtoull(optarg, 0, 10); break;
+            case 'c': chunk_size = strtoull(optarg, 0, 10); break;
+            default: usage(); return 1;
+        }
+    }
+
+    if(optind != argc - 1 || thread_count == 0 || chunk_size == 0) {
+        usage();
+        return 1;
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+        fprintf(stderr, "could not open %s\n", argv[optind]);
+        return 1;
+    }
+
+    const uint8_t *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        fprintf(stderr, "could not map %s\n", argv[optind]);
+        return 1;
+    }
+
+    record_t *records = 0;
+    int64_t record_count = index_records(map, st.st_size, &records);
+    if(record_count < 0) {
+        fprintf(stderr, "capture is truncated or could not be indexed\n");
+        return 1;
+    }
+
+    worker_t *workers = calloc(thread_count, sizeof(worker_t));
+    pthread_t *threads = calloc(thread_count, sizeof(pthread_t));
+    if(!workers || !threads) {
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for(uint64_t t = 0; t < thread_count; t++) {
+        workers[t].records = records;
+        workers[t].record_count = record_count;
+        workers[t].iterations = iterations;
+        workers[t].chunk_size = chunk_size;
+        workers[t].thread_index = t;
+        workers[t].thread_count = thread_count;
+
+        int err = pthread_create(&threads[t], 0, run_worker, &workers[t]);
+        if(err != 0) {
+            //Each thread replays its own share of the records so the results would be incomplete
+            fprintf(stderr, "could not start thread %llu: %s\n", (unsigned long long) t, strerror(err));
+            for(uint64_t started = 0; started < t; started++) {
+                pthread_join(threads[started], 0);
+            }
+            return 1;
+        }
+    }
+
+    //Adds every thread's results into the first worker
+    worker_t *total = &workers[0];
+    pthread_join(threads[0], 0);
+    for(uint64_t t = 1; t < thread_count; t++) {
+        pthread_join(threads[t], 0);
+        total -> finished += workers[t].finished;
+        total -> upgraded += workers[t].upgraded;
+        total -> incomplete += workers[t].incomplete;
+        total -> bytes += workers[t].bytes;
+        for(int e = 0; e < ERROR_COUNT; e++) {
+            total -> errors[e] += workers[t].errors[e];
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    //Records can hold more than one request
+    uint64_t parsed = total -> finished + total -> upgraded + total -> incomplete;
+    for(int e = 0; e < ERROR_COUNT; e++) {
+        parsed += total -> errors[e];
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("records: %lld, threads: %llu, iterations: %llu\n", (long long) record_count, (unsigned long long) thread_count, (unsigned long long) iterations);
+    printf("seconds: %.3f, requests/sec: %.0f, MB/sec: %.2f\n", seconds, parsed / seconds, total -> bytes / seconds / 1e6);
+    printf("requests: %llu, finished: %llu, upgraded: %llu, incomplete: %llu\n", (unsigned long long) parsed, (unsigned long long) total -> finished,
+           (unsigned long long) total -> upgraded, (unsigned long long) total -> incomplete);
+    for(int e = 1; e < ERROR_COUNT; e++) {
+        printf("%s: %llu\n", error_names[e], (unsigned long long) total -> errors[e]);
+    }
+    //ru_maxrss is in kilobytes on linux
+    printf("peak memory: %ld KB\n", usage.ru_maxrss);
+
+    free(threads);
+    free(workers);
+    free(records);
+    munmap((void*) map, st.st_size);
+
+    return 0;
+}